@@ -53,22 +53,32 @@ classdef Pipeline
             obj.codecs = codecs;
         end
 
-        function bytes = encode(obj, A)
+        function bytes = encode(obj, A, pool)
+            %ENCODE Encode one chunk. An optional parallel pool is handed to a
+            %   sharding codec for its inner chunks (ignored otherwise).
             for i = 1:obj.abIndex - 1
                 [A, ~] = obj.codecs{i}.encode(A, obj.shapes{i});
             end
-            bytes = obj.codecs{obj.abIndex}.encode(A, obj.info, obj.shapes{obj.abIndex});
+            args = {A, obj.info, obj.shapes{obj.abIndex}};
+            if nargin > 2 && ~isempty(pool) && obj.isSharded()
+                args{end + 1} = pool;
+            end
+            bytes = obj.codecs{obj.abIndex}.encode(args{:});
             for i = obj.abIndex + 1:numel(obj.codecs)
                 bytes = obj.codecs{i}.encode(bytes);
             end
         end
 
-        function A = decode(obj, bytes)
+        function A = decode(obj, bytes, pool)
+            %DECODE Decode one chunk; pool as for encode.
             for i = numel(obj.codecs):-1:obj.abIndex + 1
                 bytes = obj.codecs{i}.decode(bytes);
             end
-            A = obj.codecs{obj.abIndex}.decode(bytes, obj.info, ...
-                obj.shapes{obj.abIndex}, obj.fillValue);
+            args = {bytes, obj.info, obj.shapes{obj.abIndex}, obj.fillValue};
+            if nargin > 2 && ~isempty(pool) && obj.isSharded()
+                args{end + 1} = pool;
+            end
+            A = obj.codecs{obj.abIndex}.decode(args{:});
             for i = obj.abIndex - 1:-1:1
                 A = obj.codecs{i}.decode(A, obj.shapes{i});
             end
@@ -84,6 +94,10 @@ classdef Pipeline
             end
         end
 
+        function tf = isSharded(obj)
+            tf = isa(obj.codecs{obj.abIndex}, 'zarr.codecs.ShardingCodec');
+        end
+
         function txt = toJson(obj)
             entries = strings(1, numel(obj.codecs));
             for i = 1:numel(obj.codecs)
@@ -83,75 +83,108 @@ classdef ShardingCodec < zarr.codecs.Codec
             obj.indexLen = zarr.codecs.ShardingCodec.indexByteLength(obj.indexCodecs, obj.nChunks);
         end
 
-        function bytes = encode(obj, A, info, shardShape)
+        function bytes = encode(obj, A, info, ~, pool)
+            if nargin < 5, pool = []; end
+            w = zarr.stores.ValueWriter();
+            obj.encodeTo(A, info, w, pool);
+            bytes = w.contents();
+        end
+
+        function encodeTo(obj, A, info, w, pool)
+            %ENCODETO Encode shard A straight into a zarr.stores.ValueWriter.
+            %   Inner chunks are split out in bulk one slab (one row of inner
+            %   chunks along the first dimension) at a time, so peak memory
+            %   beyond A is one slab and one encoded chunk. With the index at
+            %   the start, a placeholder is written first and patched at the
+            %   end. With a pool, the whole shard is split at once (a copy of
+            %   A) and encoded in parallel, and all blobs are held until
+            %   written.
+            if nargin < 5, pool = []; end
             obj.assertBound();
             total = prod(obj.nChunks);
-            blobs = cell(1, total);
-            offsets = zeros(total, 1, 'uint64');
-            lens = zeros(total, 1, 'uint64');
-            sentinel = intmax('uint64');
-            fillChunk = zarr.internal.fill_array(obj.innerPipeline.fillValue, ...
-                zarr.internal.mshape(obj.chunkShape), info);
+            % All-fill inner chunks are not stored (missing-chunk sentinel).
+            offsets = repmat(intmax('uint64'), total, 1);
+            lens = offsets;
+            innerShape = zarr.internal.mshape(obj.chunkShape);
+            fv = zarr.internal.fill_array(obj.innerPipeline.fillValue, [1 1], info);
+            base = w.position;
             if obj.indexLocation == "start"
-                pos = uint64(obj.indexLen);
+                w.write(zeros(1, obj.indexLen, 'uint8'));
+            end
+            if isempty(pool)
+                c = obj.chunkShape;
+                slabGrid = [1 obj.nChunks(2:end)];
+                perSlab = prod(slabGrid);
+                slabStart = zeros(1, numel(c));
+                slabCount = c .* slabGrid;
+                for k = 1:obj.nChunks(1)
+                    slabStart(1) = (k - 1) * c(1);
+                    subs = zarr.internal.region_subs(slabStart, slabCount);
+                    cols = obj.innerColumns(A(subs{:}), slabGrid);
+                    for j = find(~obj.fillColumns(cols, fv))
+                        t = (k - 1) * perSlab + j;   % C order: dim 1 slowest
+                        blob = obj.innerPipeline.encode(reshape(cols(:, j), innerShape));
+                        offsets(t) = uint64(w.position - base);
+                        lens(t) = uint64(numel(blob));
+                        w.write(blob);
+                    end
+                end
             else
-                pos = uint64(0);
-            end
-            for t = 0:total - 1
-                coords = zarr.codecs.ShardingCodec.unravelC(t, obj.nChunks);
-                subs = subsFor(coords .* obj.chunkShape, obj.chunkShape);
-                chunk = reshape(A(subs{:}), zarr.internal.mshape(obj.chunkShape));
-                if isequaln(chunk, fillChunk)
-                    % All-fill inner chunks are not stored (missing-chunk sentinel).
-                    blobs{t + 1} = uint8.empty(1, 0);
-                    offsets(t + 1) = sentinel;
-                    lens(t + 1) = sentinel;
-                    continue
+                cols = obj.innerColumns(A);
+                live = find(~obj.fillColumns(cols, fv));
+                chunks = cell(1, numel(live));
+                for k = 1:numel(live)
+                    chunks{k} = reshape(cols(:, live(k)), innerShape);
+                end
+                inner = obj.innerPipeline;
+                blobs = zarr.internal.parallel_map(pool, @(c) inner.encode(c), chunks);
+                for k = 1:numel(live)
+                    offsets(live(k)) = uint64(w.position - base);
+                    lens(live(k)) = uint64(numel(blobs{k}));
+                    w.write(blobs{k});
                 end
-                blob = obj.innerPipeline.encode(chunk);
-                blobs{t + 1} = blob;
-                offsets(t + 1) = pos;
-                lens(t + 1) = uint64(numel(blob));
-                pos = pos + uint64(numel(blob));
-            end
-
-            I = zeros(zarr.internal.mshape([obj.nChunks 2]), 'uint64');
-            for t = 0:total - 1
-                coords = zarr.codecs.ShardingCodec.unravelC(t, obj.nChunks);
-                cSubs = num2cell(coords + 1);
-                I(cSubs{:}, 1) = offsets(t + 1);
-                I(cSubs{:}, 2) = lens(t + 1);
             end
-            indexBytes = obj.indexPipeline.encode(I);
 
+            indexBytes = obj.indexPipeline.encode(obj.buildIndex(offsets, lens));
             if obj.indexLocation == "start"
-                bytes = [indexBytes, blobs{:}];
+                w.patch(base, indexBytes);
             else
-                bytes = [blobs{:}, indexBytes];
+                w.write(indexBytes);
             end
         end
 
-        function A = decode(obj, bytes, info, shardShape, fillValue)
+        function A = decode(obj, bytes, info, ~, fillValue, pool)
+            %DECODE Decode a whole shard. Inner chunks are independent: with
+            %   a pool they are decoded in parallel; either way they are
+            %   assembled column-wise and reshaped into the shard at once.
             obj.assertBound();
-            if nargin < 5
+            if nargin < 5 || isempty(fillValue)
                 fillValue = obj.innerPipeline.fillValue;
             end
-            I = obj.decodeIndex(bytes);
-            A = zarr.internal.fill_array(fillValue, zarr.internal.mshape(shardShape), info);
+            if nargin < 6, pool = []; end
+            [offsets, lens] = obj.indexEntries(obj.decodeIndex(bytes));
             sentinel = intmax('uint64');
-            total = prod(obj.nChunks);
-            for t = 0:total - 1
-                coords = zarr.codecs.ShardingCodec.unravelC(t, obj.nChunks);
-                cSubs = num2cell(coords + 1);
-                off = I(cSubs{:}, 1);
-                len = I(cSubs{:}, 2);
-                if off == sentinel && len == sentinel
-                    continue
+            live = find(~(offsets == sentinel & lens == sentinel));
+            if any(offsets(live) + lens(live) > numel(bytes))
+                error("zarr:CodecError", "Shard index points past the end of the shard.");
+            end
+            cols = zarr.internal.fill_array(fillValue, ...
+                [prod(obj.chunkShape) prod(obj.nChunks)], info);
+            slice = @(k) bytes(double(offsets(live(k))) + 1:double(offsets(live(k)) + lens(live(k))));
+            if isempty(pool)
+                for k = 1:numel(live)
+                    chunk = obj.innerPipeline.decode(slice(k));
+                    cols(:, live(k)) = chunk(:);
+                end
+            else
+                slices = arrayfun(slice, 1:numel(live), 'UniformOutput', false);
+                inner = obj.innerPipeline;
+                chunks = zarr.internal.parallel_map(pool, @(b) inner.decode(b), slices);
+                for k = 1:numel(live)
+                    cols(:, live(k)) = chunks{k}(:);
                 end
-                chunk = obj.innerPipeline.decode(bytes(double(off) + 1:double(off + len)));
-                subs = subsFor(coords .* obj.chunkShape, obj.chunkShape);
-                A(subs{:}) = chunk;
             end
+            A = obj.joinColumns(cols);
         end
 
         function I = decodeIndex(obj, indexOrShardBytes)
@@ -168,15 +201,124 @@ classdef ShardingCodec < zarr.codecs.Codec
             end
             I = obj.indexPipeline.decode(ib);
         end
+
+        function bytes = assemble(obj, blobs)
+            %ASSEMBLE Serialize a shard from already-encoded inner chunks:
+            %   blobs is a cell with one entry per inner chunk in C order,
+            %   empty for missing (elided) chunks.
+            w = zarr.stores.ValueWriter();
+            obj.assembleTo(blobs, w);
+            bytes = w.contents();
+        end
+
+        function assembleTo(obj, blobs, w)
+            %ASSEMBLETO Like assemble, writing into a zarr.stores.ValueWriter.
+            obj.assertBound();
+            lens = cellfun(@numel, blobs(:));
+            missing = lens == 0;
+            offsets = uint64(cumsum([0; lens(1:end - 1)]));
+            if obj.indexLocation == "start"
+                offsets = offsets + uint64(obj.indexLen);
+            end
+            lens = uint64(lens);
+            offsets(missing) = intmax('uint64');
+            lens(missing) = intmax('uint64');
+            indexBytes = obj.indexPipeline.encode(obj.buildIndex(offsets, lens));
+            if obj.indexLocation == "start"
+                w.write(indexBytes);
+            end
+            for t = find(~missing)'
+                w.write(blobs{t});
+            end
+            if obj.indexLocation == "end"
+                w.write(indexBytes);
+            end
+        end
+
+        function [offsets, lens] = indexEntries(obj, I)
+            %INDEXENTRIES Offsets and lengths from a decoded index, as
+            %   uint64 columns in C order (entry t+1 is inner chunk t).
+            total = prod(obj.nChunks);
+            offsets = obj.fToC(I(1:total));
+            lens = obj.fToC(I(total + 1:2 * total));
+        end
+
+        function I = buildIndex(obj, offsets, lens)
+            %BUILDINDEX Inverse of indexEntries: C-order columns -> index array.
+            I = zeros(zarr.internal.mshape([obj.nChunks 2]), 'uint64');
+            I(:) = [obj.cToF(offsets(:)); obj.cToF(lens(:))];
+        end
     end
 
     methods (Access = private)
+        function cols = innerColumns(obj, A, n)
+            %INNERCOLUMNS Split a shard into inner chunks in one pass: column
+            %   t holds the elements of inner chunk t (1-based, C order) in
+            %   MATLAB order. Shard dimension d of length c(d)*n(d) is split
+            %   into (c(d), n(d)); chunk dims come first, grid dims last and
+            %   reversed so the column index runs in C order. A may be part
+            %   of a shard holding a grid n of inner chunks (default: all).
+            c = obj.chunkShape;
+            if nargin < 3
+                n = obj.nChunks;
+            end
+            R = numel(c);
+            B = reshape(A, reshape([c; n], 1, []));
+            B = permute(B, [1:2:2 * R, 2 * R:-2:2]);
+            cols = reshape(B, prod(c), prod(n));
+        end
+
+        function A = joinColumns(obj, cols)
+            %JOINCOLUMNS Inverse of innerColumns: columns back into a shard.
+            c = obj.chunkShape;
+            n = obj.nChunks;
+            R = numel(c);
+            B = reshape(cols, [c, fliplr(n)]);
+            B = ipermute(B, [1:2:2 * R, 2 * R:-2:2]);
+            A = reshape(B, zarr.internal.mshape(c .* n));
+        end
+
+        function isFill = fillColumns(~, cols, fv)
+            %FILLCOLUMNS Row vector: true where a column of innerColumns is
+            %   entirely the fill value fv (a scalar; isequaln semantics).
+            if isnumeric(cols)
+                same = @(a, b) a == b | (isnan(a) & isnan(b));
+                isFill = all(same(real(cols), real(fv)) & same(imag(cols), imag(fv)), 1);
+            elseif islogical(cols) || isstring(cols)
+                isFill = all(cols == fv, 1);
+            else
+                isFill = false(1, size(cols, 2));
+                fillCol = repmat(fv, size(cols, 1), 1);
+                for t = 1:size(cols, 2)
+                    isFill(t) = isequaln(cols(:, t), fillCol);
+                end
+            end
+        end
+
         function assertBound(obj)
             if isempty(obj.innerPipeline)
                 error("zarr:InternalError", ...
                     "ShardingCodec used outside a Pipeline (bind() not called).");
             end
         end
+
+        function v = fToC(obj, v)
+            %FTOC Reorder a per-inner-chunk vector from MATLAB (first
+            %   dimension fastest) to C order (last dimension fastest).
+            R = numel(obj.nChunks);
+            if R >= 2
+                v = permute(reshape(v, obj.nChunks), R:-1:1);
+            end
+            v = v(:);
+        end
+
+        function v = cToF(obj, v)
+            R = numel(obj.nChunks);
+            if R >= 2
+                v = permute(reshape(v, fliplr(obj.nChunks)), R:-1:1);
+            end
+            v = v(:);
+        end
     end
 
     methods (Static)
@@ -211,21 +353,17 @@ classdef ShardingCodec < zarr.codecs.Codec
             end
         end
 
+        function t = ravelC(coords, dims)
+            %RAVELC 0-based coords -> 0-based linear index, C order.
+            strides = [fliplr(cumprod(dims(end:-1:2))), 1];
+            t = sum(coords .* strides);
+        end
+
         function coords = unravelC(t, dims)
-            %UNRAVELC 0-based linear index -> 0-based coords, C order (last fastest).
-            R = numel(dims);
-            coords = zeros(1, R);
-            for d = R:-1:1
-                coords(d) = mod(t, dims(d));
-                t = floor(t / dims(d));
-            end
+            %UNRAVELC 0-based linear index -> 0-based coords, C order (last
+            %   fastest). A vector t gives one row of coords per element.
+            strides = [fliplr(cumprod(dims(end:-1:2))), 1];
+            coords = mod(floor(t(:) ./ strides), dims);
         end
     end
 end
-
-function subs = subsFor(start0, count)
-subs = arrayfun(@(s, c) s + 1:s + c, start0, count, 'UniformOutput', false);
-if isscalar(subs)
-    subs{end + 1} = 1;
-end
-end
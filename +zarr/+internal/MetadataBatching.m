@@ -0,0 +1,88 @@
+classdef (Abstract) MetadataBatching < handle
+    %METADATABATCHING Coalesced zarr.json writes, shared by zarr.Array and
+    %   zarr.Group. A node calls deferMetadataWrite at the top of its
+    %   writeMetadata; inside a batch the write is skipped and made once
+    %   by the outermost commitMetadataBatch. The node provides
+    %   writeMetadata, metadataSnapshot and restoreMetadata.
+
+    properties (Access = private)
+        metaBatchDepth (1,1) double = 0
+        metaBatchSnapshot = []
+        metaBatchDirty (1,1) logical = false
+    end
+
+    methods
+        function batchMetadata(obj, fn)
+            %BATCHMETADATA Run fn() with zarr.json writes coalesced:
+            %   metadata changes inside fn (setAttr, setAttrs; resize on
+            %   arrays) are written once, when fn returns. If fn errors, the
+            %   metadata is rolled back and nothing is written.
+            obj.beginMetadataBatch();
+            try
+                fn();
+            catch err
+                obj.rollbackMetadataBatch();
+                rethrow(err);
+            end
+            obj.commitMetadataBatch();
+        end
+
+        function beginMetadataBatch(obj)
+            %BEGINMETADATABATCH Defer zarr.json writes until the matching
+            %   commitMetadataBatch. Batches nest; the outermost commit writes.
+            if obj.metaBatchDepth == 0
+                obj.metaBatchSnapshot = obj.metadataSnapshot();
+                obj.metaBatchDirty = false;
+            end
+            obj.metaBatchDepth = obj.metaBatchDepth + 1;
+        end
+
+        function commitMetadataBatch(obj)
+            if obj.metaBatchDepth == 0
+                error("zarr:StoreError", "No metadata batch is open on '/%s'.", obj.path);
+            end
+            obj.metaBatchDepth = obj.metaBatchDepth - 1;
+            if obj.metaBatchDepth == 0
+                obj.metaBatchSnapshot = [];
+                if obj.metaBatchDirty
+                    obj.metaBatchDirty = false;
+                    obj.writeMetadata();
+                end
+            end
+        end
+
+        function rollbackMetadataBatch(obj)
+            %ROLLBACKMETADATABATCH Discard all metadata changes since the
+            %   outermost beginMetadataBatch and close every open batch.
+            if obj.metaBatchDepth == 0
+                return
+            end
+            obj.restoreMetadata(obj.metaBatchSnapshot);
+            obj.metaBatchDepth = 0;
+            obj.metaBatchSnapshot = [];
+            obj.metaBatchDirty = false;
+        end
+    end
+
+    methods (Access = protected)
+        function tf = inMetadataBatch(obj)
+            %INMETADATABATCH True while a batch is open.
+            tf = obj.metaBatchDepth > 0;
+        end
+
+        function tf = deferMetadataWrite(obj)
+            %DEFERMETADATAWRITE True inside a batch, where the write is
+            %   left to the outermost commit.
+            tf = obj.metaBatchDepth > 0;
+            if tf
+                obj.metaBatchDirty = true;
+            end
+        end
+    end
+
+    methods (Abstract, Access = protected)
+        writeMetadata(obj)
+        m = metadataSnapshot(obj)
+        restoreMetadata(obj, m)
+    end
+end
@@ -0,0 +1,175 @@
+classdef StagedChunkStore < zarr.stores.Store
+    %STAGEDCHUNKSTORE Store view of an array whose re-encoded chunks
+    %   zarr.transcode is moving in. zarr.json already names the new codec
+    %   chain and carries the attribute named by Attribute; until the move
+    %   ends, a chunk is read from the staging node while a staged value
+    %   exists and from its own key once it has been moved. Writes go to
+    %   the chunk's own key and drop its staged value. Everything else
+    %   passes through to inner. zarr.Array wraps its store in one while
+    %   its metadata carries the attribute (see wrap).
+
+    properties (Constant)
+        Attribute = "zarr_matlab_transcode"   % value: the staging node name
+    end
+
+    properties (SetAccess = immutable)
+        inner
+        prefix (1,1) string    % the array's key prefix ("" or "path/")
+        staging (1,1) string   % the staging node's key prefix
+    end
+
+    methods (Static)
+        function store = wrap(store, path, meta)
+            %WRAP The store an array at path with metadata meta reads
+            %   through: store itself, or a StagedChunkStore over it while
+            %   meta marks a transcode move.
+            if isa(store, "zarr.internal.StagedChunkStore")
+                store = store.inner;
+            end
+            attr = zarr.internal.StagedChunkStore.Attribute;
+            if ~isfield(meta.attributes, attr)
+                return
+            end
+            if strlength(path) == 0
+                prefix = "";
+            else
+                prefix = path + "/";
+            end
+            store = zarr.internal.StagedChunkStore(store, prefix, ...
+                prefix + string(meta.attributes.(attr)) + "/");
+        end
+    end
+
+    methods
+        function obj = StagedChunkStore(inner, prefix, staging)
+            obj.inner = inner;
+            obj.prefix = prefix;
+            obj.staging = staging;
+        end
+
+        function [data, found] = get(obj, key)
+            [s, staged] = obj.stagedKey(key);
+            if staged
+                [data, found] = obj.inner.get(s);
+                if found
+                    return
+                end
+            end
+            [data, found] = obj.inner.get(key);
+        end
+
+        function [data, found] = getPartial(obj, key, offset, len)
+            [s, staged] = obj.stagedKey(key);
+            if staged
+                [data, found] = obj.inner.getPartial(s, offset, len);
+                if found
+                    return
+                end
+            end
+            [data, found] = obj.inner.getPartial(key, offset, len);
+        end
+
+        function [data, found] = getSuffix(obj, key, len)
+            [s, staged] = obj.stagedKey(key);
+            if staged
+                [data, found] = obj.inner.getSuffix(s, len);
+                if found
+                    return
+                end
+            end
+            [data, found] = obj.inner.getSuffix(key, len);
+        end
+
+        function [parts, found] = getRanges(obj, key, offsets, lens)
+            [s, staged] = obj.stagedKey(key);
+            if staged
+                [parts, found] = obj.inner.getRanges(s, offsets, lens);
+                if found
+                    return
+                end
+            end
+            [parts, found] = obj.inner.getRanges(key, offsets, lens);
+        end
+
+        function [n, found] = sizeOf(obj, key)
+            [s, staged] = obj.stagedKey(key);
+            if staged
+                [n, found] = obj.inner.sizeOf(s);
+                if found
+                    return
+                end
+            end
+            [n, found] = obj.inner.sizeOf(key);
+        end
+
+        function [values, found] = getMany(obj, keys)
+            keys = reshape(string(keys), 1, []);
+            [s, staged] = obj.stagedKey(keys);
+            values = cell(1, numel(keys));
+            found = false(1, numel(keys));
+            [values(staged), found(staged)] = obj.inner.getMany(s(staged));
+            rest = ~found;
+            [values(rest), found(rest)] = obj.inner.getMany(keys(rest));
+        end
+
+        function tf = exists(obj, key)
+            [s, staged] = obj.stagedKey(key);
+            tf = (staged && obj.inner.exists(s)) || obj.inner.exists(key);
+        end
+
+        function set(obj, key, data)
+            obj.inner.set(key, data);
+            [s, staged] = obj.stagedKey(key);
+            if staged
+                obj.inner.erase(s);
+            end
+        end
+
+        function erase(obj, key)
+            obj.inner.erase(key);
+            [s, staged] = obj.stagedKey(key);
+            if staged
+                obj.inner.erase(s);
+            end
+        end
+
+        function keys = list(obj)
+            keys = obj.inner.list();
+        end
+
+        function keys = listPrefix(obj, prefix)
+            keys = obj.inner.listPrefix(prefix);
+        end
+
+        function [subdirs, files] = listDir(obj, prefix)
+            [subdirs, files] = obj.inner.listDir(prefix);
+        end
+
+        function tf = isParallelSafe(obj)
+            tf = obj.inner.isParallelSafe();
+        end
+
+        function lock = lockKey(obj, key)
+            lock = obj.inner.lockKey(key);
+        end
+
+        function batch = batchSync(obj)
+            batch = obj.inner.batchSync();
+        end
+    end
+
+    methods (Access = private)
+        function [s, staged] = stagedKey(obj, keys)
+            % Staged counterparts of the array's chunk keys; staged(i) is
+            % false for keys that are not chunks of the array.
+            keys = string(keys);
+            s = keys;
+            staged = startsWith(keys, obj.prefix);
+            rel = extractAfter(keys(staged), strlength(obj.prefix));
+            chunk = rel ~= "zarr.json" & ~startsWith(rel, ".");
+            idx = find(staged);
+            staged(idx(~chunk)) = false;
+            s(staged) = obj.staging + rel(chunk);
+        end
+    end
+end
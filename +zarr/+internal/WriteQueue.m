@@ -0,0 +1,99 @@
+classdef WriteQueue < handle
+    %WRITEQUEUE Background write queue behind zarr.Array/writeAsync.
+    %   Each submitted region write runs z.write on a pool worker, against
+    %   the copy of the array (and its store) sent with the task. In-flight
+    %   bytes are bounded by maxBytes: submit blocks on the oldest writes
+    %   until the new one fits. A write first waits for in-flight writes
+    %   that touch any of the same chunks, so chunk read-modify-write never
+    %   races. Worker errors are collected and raised by wait(); a queue
+    %   destroyed before that waits for its writes and warns about them.
+
+    properties
+        pool
+        maxBytes (1,1) double
+    end
+
+    properties (SetAccess = private)
+        inFlightBytes (1,1) double = 0
+    end
+
+    properties (Access = private)
+        futures = {}
+        bytes = zeros(0, 1)
+        keys = {}       % chunk keys touched by each in-flight write
+        errors = {}
+    end
+
+    methods
+        function obj = WriteQueue(pool, maxBytes)
+            obj.pool = pool;
+            obj.maxBytes = maxBytes;
+        end
+
+        function submit(obj, z, data, start, keys)
+            obj.reap();
+            for i = numel(obj.futures):-1:1
+                if any(ismember(keys, obj.keys{i}))
+                    obj.finish(i);
+                end
+            end
+            nBytes = whos('data').bytes;
+            while ~isempty(obj.futures) && obj.inFlightBytes + nBytes > obj.maxBytes
+                obj.finish(1);
+            end
+            obj.futures{end + 1} = parfeval(obj.pool, @write_region, 0, z, data, start);
+            obj.bytes(end + 1) = nBytes;
+            obj.keys{end + 1} = keys;
+            obj.inFlightBytes = obj.inFlightBytes + nBytes;
+        end
+
+        function wait(obj)
+            while ~isempty(obj.futures)
+                obj.finish(1);
+            end
+            if ~isempty(obj.errors)
+                errs = obj.errors;
+                obj.errors = {};
+                err = MException("zarr:StoreError", ...
+                    "%d asynchronous write(s) failed; first error: %s", ...
+                    numel(errs), errs{1}.message);
+                throw(err.addCause(errs{1}));
+            end
+        end
+
+        function delete(obj)
+            try % destructor must not throw, but the failure must be visible
+                obj.wait();
+            catch err
+                warning("zarr:StoreError", ...
+                    "Asynchronous writes not waited for: %s", err.message);
+            end
+        end
+    end
+
+    methods (Access = private)
+        function reap(obj)
+            for i = numel(obj.futures):-1:1
+                if obj.futures{i}.State == "finished"
+                    obj.finish(i);
+                end
+            end
+        end
+
+        function finish(obj, i)
+            f = obj.futures{i};
+            wait(f);
+            if ~isempty(f.Error)
+                obj.errors{end + 1} = f.Error;
+            end
+            obj.inFlightBytes = obj.inFlightBytes - obj.bytes(i);
+            obj.futures(i) = [];
+            obj.bytes(i) = [];
+            obj.keys(i) = [];
+        end
+    end
+end
+
+function write_region(z, data, start)
+z.write(data, start);
+end
@@ -0,0 +1,17 @@
+function [starts, counts] = aligned_blocks(shape, blockShape)
+%ALIGNED_BLOCKS Tile an array into blocks aligned to blockShape.
+%   [starts, counts] = aligned_blocks(shape, blockShape) returns one row
+%   per block in C order: 1-based starts and extents clipped to shape.
+%   Blocks aligned to the chunk (shard) grid never share a storage object.
+
+shape = reshape(double(shape), 1, []);
+blockShape = reshape(double(blockShape), 1, []);
+R = numel(shape);
+parts = zarr.internal.chunk_intersections(zeros(1, R), shape, blockShape);
+starts = reshape([parts.coords], R, []).' .* blockShape + 1;
+counts = reshape([parts.inCount], R, []).';
+if isempty(parts)
+    starts = zeros(0, R);
+    counts = zeros(0, R);
+end
+end
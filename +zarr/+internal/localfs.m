@@ -0,0 +1,101 @@
+function varargout = localfs(cmd, varargin)
+%LOCALFS File primitives behind zarr.stores.LocalStore.
+%   zarr.internal.localfs("rename", from, to)   atomic replace of to
+%   zarr.internal.localfs("fsync", path)        flush a file or directory
+%   [data, found] = zarr.internal.localfs("pread", path, offset, len)
+%                                              len = Inf reads to EOF
+%   [data, found] = zarr.internal.localfs("tail", path, len)
+%   zarr.internal.localfs("forget", path)       drop a cached read handle
+%   keys = zarr.internal.localfs("list", dir)   relative paths of all files
+%                                              below dir ('/'-separated,
+%                                              unsorted)
+%
+%   Uses the MEX implementation when built (tools/build_mex.m), which keeps
+%   an LRU cache of open read handles and reads with pread; otherwise
+%   java.nio for rename/fsync (directory fsync is skipped where the
+%   platform refuses it) and fopen/fread per read. A missing file reads as
+%   found = false.
+
+persistent useMex
+if isempty(useMex)
+    useMex = ~isempty(which('zarr.internal.localfs_mex'));
+end
+args = varargin;
+for i = 1:numel(args)
+    if isstring(args{i})
+        args{i} = char(args{i});
+    end
+end
+if useMex && cmd == "list"
+    bytes = zarr.internal.localfs_mex('list', args{:});
+    if isempty(bytes)
+        varargout = {strings(0, 1)};
+    else
+        varargout = {split(string(native2unicode(bytes(1:end - 1), 'UTF-8')), newline)};
+    end
+    return
+elseif useMex
+    [varargout{1:nargout}] = zarr.internal.localfs_mex(char(cmd), args{:});
+    return
+end
+
+switch cmd
+    case "rename"
+        opts = javaArray('java.nio.file.CopyOption', 2);
+        opts(1) = java.nio.file.StandardCopyOption.ATOMIC_MOVE;
+        opts(2) = java.nio.file.StandardCopyOption.REPLACE_EXISTING;
+        try
+            java.nio.file.Files.move(java.io.File(args{1}).toPath(), ...
+                java.io.File(args{2}).toPath(), opts);
+        catch err
+            error("zarr:StoreError", "rename '%s' -> '%s' failed: %s", ...
+                args{1}, args{2}, err.message);
+        end
+    case "fsync"
+        opts = javaArray('java.nio.file.OpenOption', 1);
+        opts(1) = java.nio.file.StandardOpenOption.READ;
+        if isfolder(args{1})
+            try
+                ch = java.nio.channels.FileChannel.open(java.io.File(args{1}).toPath(), opts);
+            catch
+                return  % e.g. Windows: directories cannot be opened for sync
+            end
+        else
+            ch = java.nio.channels.FileChannel.open(java.io.File(args{1}).toPath(), opts);
+        end
+        closer = onCleanup(@() ch.close());
+        ch.force(true);
+    case {"pread", "tail"}
+        fid = fopen(args{1}, 'r');
+        if fid == -1
+            varargout = {uint8([]), false};
+            return
+        end
+        closer = onCleanup(@() fclose(fid));
+        if cmd == "pread"
+            fseek(fid, args{2}, 'bof');
+        else
+            fseek(fid, 0, 'eof');
+            fseek(fid, max(0, ftell(fid) - args{2}), 'bof');
+        end
+        varargout = {fread(fid, args{end}, '*uint8')', true};
+    case "list"
+        keys = strings(0, 1);
+        if isfolder(args{1})
+            entries = dir(fullfile(args{1}, '**', '*'));
+            entries = entries(~[entries.isdir]);
+            if ~isempty(entries)
+                listing = dir(args{1});   % its "." entry holds the absolute path
+                top = string(listing(1).folder);
+                full = fullfile(string({entries.folder}'), string({entries.name}'));
+                keys = strip(extractAfter(full, strlength(top)), 'left', filesep);
+                keys = replace(keys, filesep, "/");
+            end
+        end
+        varargout = {keys};
+    case {"forget", "closeall"}
+        % no handles are cached without the MEX
+    otherwise
+        error("zarr:InternalError", "Unknown localfs command '%s'.", cmd);
+end
+end
@@ -0,0 +1,28 @@
+function out = parallel_map(pool, fn, items)
+%PARALLEL_MAP out{i} = fn(items{i}), one batch per worker of pool.
+%   Runs serially when pool is empty or there are fewer than two items.
+%   Output is a row cell. A worker error is rethrown by fetchOutputs.
+
+items = reshape(items, 1, []);
+n = numel(items);
+out = cell(1, n);
+if isempty(pool) || n < 2
+    for i = 1:n
+        out{i} = fn(items{i});
+    end
+    return
+end
+nb = min(n, max(1, pool.NumWorkers));
+edges = round(linspace(0, n, nb + 1));
+futures = cell(1, nb);
+for b = 1:nb
+    futures{b} = parfeval(pool, @map_batch, 1, fn, items(edges(b) + 1:edges(b + 1)));
+end
+for b = 1:nb
+    out(edges(b) + 1:edges(b + 1)) = fetchOutputs(futures{b});
+end
+end
+
+function out = map_batch(fn, items)
+out = cellfun(fn, items, 'UniformOutput', false);
+end
@@ -0,0 +1,10 @@
+function subs = region_subs(start0, count)
+%REGION_SUBS Subscripts {s1+1:s1+c1, ...} of a region given its 0-based
+%   start and count per dimension, for indexing MATLAB arrays. Rank-1
+%   regions get a trailing 1, since rank-1 arrays are column vectors.
+
+subs = arrayfun(@(s, c) s + 1:s + c, start0, count, 'UniformOutput', false);
+if isscalar(subs)
+    subs{end + 1} = 1;
+end
+end
@@ -0,0 +1,93 @@
+classdef FileValueWriter < zarr.stores.ValueWriter
+    %FILEVALUEWRITER Streams a store value into a temporary file.
+    %   w = zarr.stores.FileValueWriter(tmpPath, publish) writes to tmpPath;
+    %   commit closes the file and calls publish(tmpPath), which takes
+    %   ownership of it (LocalStore moves it into place, ZipStore keeps it
+    %   as a spilled entry). abort closes and deletes the file.
+    %
+    %   w = zarr.stores.FileValueWriter(path, publish, InPlace=true) writes
+    %   the key's own file instead (LocalStore, Durability="none"). It is
+    %   opened (and truncated) only by the first write or by commit, and
+    %   never deleted: an abort before any write leaves the old value.
+
+    properties (Access = private)
+        tmpPath (1,1) string
+        publish
+        inPlace (1,1) logical = false
+        fid = -1
+    end
+
+    methods
+        function obj = FileValueWriter(tmpPath, publish, opts)
+            arguments
+                tmpPath
+                publish
+                opts.InPlace (1,1) logical = false
+            end
+            obj.tmpPath = tmpPath;
+            obj.publish = publish;
+            obj.inPlace = opts.InPlace;
+            if ~obj.inPlace
+                obj.ensureOpen();
+            end
+        end
+    end
+
+    methods (Access = protected)
+        function writeImpl(obj, data)
+            obj.ensureOpen();
+            fwrite(obj.fid, data, 'uint8');
+        end
+
+        function patchImpl(obj, offset, data)
+            fseek(obj.fid, offset, 'bof');
+            fwrite(obj.fid, data, 'uint8');
+            fseek(obj.fid, 0, 'eof');
+        end
+
+        function commitImpl(obj)
+            obj.ensureOpen();   % an empty value still replaces the old one
+            if fclose(obj.fid) ~= 0
+                obj.fid = -1;
+                obj.deleteTemp();
+                error("zarr:StoreError", "Failed to finish writing '%s'.", obj.tmpPath);
+            end
+            obj.fid = -1;
+            try
+                obj.publish(obj.tmpPath);
+            catch err
+                obj.deleteTemp();
+                rethrow(err);
+            end
+        end
+
+        function abortImpl(obj)
+            if obj.fid ~= -1
+                fclose(obj.fid);
+                obj.fid = -1;
+            end
+            obj.deleteTemp();
+        end
+    end
+
+    methods (Access = private)
+        function ensureOpen(obj)
+            if obj.fid ~= -1
+                return
+            end
+            obj.fid = fopen(obj.tmpPath, 'w+');
+            if obj.fid == -1
+                error("zarr:StoreError", "Cannot write to '%s'.", obj.tmpPath);
+            end
+        end
+
+        function deleteTemp(obj)
+            if obj.inPlace
+                return   % the key's own file: never remove the value
+            end
+            if isfile(obj.tmpPath)
+                delete(obj.tmpPath);
+            end
+        end
+    end
+end
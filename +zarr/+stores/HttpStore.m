@@ -1,34 +1,71 @@
 classdef HttpStore < zarr.stores.Store
     %HTTPSTORE Read-only Zarr store over HTTP(S).
     %   zarr.stores.HttpStore("https://host/path/to/root")
+    %   zarr.stores.HttpStore(url, MaxConcurrency=16, Timeout=30, MaxRangeGap=65536)
     %
     %   Uses Range requests for partial reads when the server supports them
     %   (S3, nginx, most CDNs), so sharded arrays fetch only the byte ranges
     %   they need; falls back to full-object reads otherwise.
     %
+    %   Requests go through one java.net.http.HttpClient per store, which
+    %   keeps connections alive between requests (and multiplexes them over
+    %   HTTP/2 on https). getMany - used by Array.read for the chunks of a
+    %   region - keeps up to MaxConcurrency requests in flight, so a read
+    %   touching many chunks costs a few round trips rather than one per
+    %   chunk. On a Java runtime without java.net.http (Java 8) requests
+    %   fall back to webread, one at a time.
+    %
+    %   getRanges (the inner chunks of a shard) asks for all ranges in one
+    %   "Range: bytes=a-b,c-d" request and parses the multipart/byteranges
+    %   reply. Servers that do not support multiple ranges (S3 among them)
+    %   are detected on the first such reply; from then on this store
+    %   sends the ranges as concurrent single-range requests.
+    %
     %   HTTP servers are not listable, so hierarchy browsing (children/tree)
     %   requires consolidated metadata (zarr.consolidate_metadata). Direct
     %   opens by path (zarr.open(store, Path="a/b")) always work.
 
     properties (SetAccess = immutable)
         baseUrl (1,1) string
+        maxConcurrency (1,1) double = 16
+        timeout (1,1) double = 30   % seconds, per request
+        maxRangeGap (1,1) double = 65536   % bytes; closer ranges are fetched as one
+    end
+
+    properties (Access = private, Transient)
+        client = []   % java.net.http.HttpClient, created on first use
+        multiRange (1,1) logical = true   % cleared when the server refuses
     end
 
     methods
-        function obj = HttpStore(baseUrl)
+        function obj = HttpStore(baseUrl, opts)
+            arguments
+                baseUrl
+                opts.MaxConcurrency (1,1) double {mustBeInteger, mustBePositive} = 16
+                opts.Timeout (1,1) double {mustBePositive} = 30
+                opts.MaxRangeGap (1,1) double {mustBeNonnegative} = 65536
+            end
             obj.baseUrl = strip(string(baseUrl), 'right', '/');
+            obj.maxConcurrency = opts.MaxConcurrency;
+            obj.timeout = opts.Timeout;
+            obj.maxRangeGap = opts.MaxRangeGap;
         end
 
         function [data, found] = get(obj, key)
-            [data, found] = obj.fetch(key, []);
+            [values, found] = obj.fetch(string(key), {''});
+            data = values{1};
+        end
+
+        function [values, found] = getMany(obj, keys)
+            keys = reshape(string(keys), 1, []);
+            [values, found] = obj.fetch(keys, repmat({''}, 1, numel(keys)));
         end
 
         function [data, found] = getPartial(obj, key, offset, len)
-            [data, found] = obj.fetch(key, sprintf('bytes=%d-%d', offset, offset + len - 1));
-            if ~found
-                return
-            end
-            if numel(data) > len
+            [values, found] = obj.fetch(string(key), ...
+                {sprintf('bytes=%d-%d', offset, offset + len - 1)});
+            data = values{1};
+            if found && numel(data) > len
                 % Server ignored the Range header and sent the whole object.
                 first = offset + 1;
                 data = data(first:min(offset + len, numel(data)));
@@ -36,12 +73,60 @@ classdef HttpStore < zarr.stores.Store
         end
 
         function [data, found] = getSuffix(obj, key, len)
-            [data, found] = obj.fetch(key, sprintf('bytes=-%d', len));
+            [values, found] = obj.fetch(string(key), {sprintf('bytes=-%d', len)});
+            data = values{1};
+            if found && numel(data) > len
+                data = data(end - len + 1:end);
+            end
+        end
+
+        function [parts, found] = getRanges(obj, key, offsets, lens)
+            % Ranges closer than maxRangeGap are merged, then all spans go in
+            % one multi-range request (64 per request). A server whose
+            % successful reply has fewer ranges than asked, or ignores
+            % Range, gets the missing spans as concurrent single-range
+            % requests, and only those from then on. Error replies raise as
+            % they do for single requests.
+            offsets = reshape(double(offsets), 1, []);
+            lens = reshape(double(lens), 1, []);
+            [starts, stops, owner] = mergeRanges(offsets, lens, obj.maxRangeGap);
+            spans = cell(1, numel(starts));
+            got = false(1, numel(starts));
+            found = true;
+            if obj.multiRange && numel(starts) > 1 && zarr.stores.HttpStore.hasHttpClient()
+                for first = 1:64:numel(starts)
+                    idx = first:min(first + 63, numel(starts));
+                    [spans(idx), got(idx), found, refused] = ...
+                        obj.multiRangeFetch(key, starts(idx), stops(idx));
+                    if ~found
+                        parts = cell(1, numel(offsets));
+                        return
+                    end
+                    if refused
+                        % the rest of this call, and later calls, go
+                        % straight to single-range requests
+                        obj.multiRange = false;
+                        break
+                    end
+                end
+            end
+            if ~all(got)
+                rest = find(~got);
+                ranges = cellstr(compose("bytes=%d-%d", starts(rest)', stops(rest)' - 1))';
+                [spans(rest), f] = obj.fetch(repmat(string(key), 1, numel(rest)), ranges);
+                found = all(f);
+            end
+            parts = cell(1, numel(offsets));
             if ~found
                 return
             end
-            if numel(data) > len
-                data = data(end - len + 1:end);
+            for i = 1:numel(offsets)
+                s = spans{owner(i)};
+                first = offsets(i) - starts(owner(i)) + 1;
+                if numel(s) > stops(owner(i)) - starts(owner(i))
+                    first = offsets(i) + 1;   % whole value: Range was ignored
+                end
+                parts{i} = s(first:min(first + lens(i) - 1, numel(s)));
             end
         end
 
@@ -69,21 +154,137 @@ classdef HttpStore < zarr.stores.Store
     end
 
     methods (Access = private)
-        function [data, found] = fetch(obj, key, rangeHeader)
+        function [values, found] = fetch(obj, keys, ranges)
+            % GET keys(i) with Range header ranges{i} ('' for the whole
+            % value), keeping up to maxConcurrency requests in flight.
+            n = numel(keys);
+            values = cell(1, n);
+            found = false(1, n);
+            if ~zarr.stores.HttpStore.hasHttpClient()
+                for i = 1:n
+                    [values{i}, found(i)] = obj.webFetch(keys(i), ranges{i});
+                end
+                return
+            end
+            responses = obj.send(keys, ranges);
+            for i = 1:n
+                [values{i}, found(i)] = readResponse(responses{i}, keys(i));
+                responses{i} = [];
+            end
+        end
+
+        function responses = send(obj, keys, ranges)
+            % The java.net.http responses of fetch's requests, in order.
+            n = numel(keys);
+            client = obj.httpClient();
+            handler = java.net.http.HttpResponse.BodyHandlers.ofByteArray();
+            responses = cell(1, n);
+            pending = cell(1, n);
+            next = 1;
+            for i = 1:n
+                while next <= n && next < i + obj.maxConcurrency
+                    pending{next} = client.sendAsync(obj.request(keys(next), ranges{next}), handler);
+                    next = next + 1;
+                end
+                try
+                    responses{i} = pending{i}.get();
+                    pending{i} = [];
+                catch err
+                    cancelAll(pending);
+                    error("zarr:StoreError", "HTTP request for '%s' failed: %s", keys(i), err.message);
+                end
+            end
+        end
+
+        function [spans, ok, found, refused] = multiRangeFetch(obj, key, starts, stops)
+            % Spans [starts(k), stops(k)) of key in one multi-range request;
+            % ok(k) is false for spans the response did not contain.
+            % refused is true when a successful reply ignored Range or left
+            % ranges out; error statuses raise through readResponse.
+            list = join(compose("%d-%d", [starts(:), stops(:) - 1]), ",");
+            responses = obj.send(string(key), {char("bytes=" + list)});
+            r = responses{1};
+            [body, found] = readResponse(r, key);
+            status = r.statusCode();
+            spans = cell(1, numel(starts));
+            ok = false(1, numel(starts));
+            refused = false;
+            if ~found || ~ismember(status, [200 206])
+                return   % 416: the single-range requests sort it out
+            end
+            contentType = char(r.headers().firstValue('content-type').orElse(''));
+            boundary = regexp(contentType, 'multipart/byteranges;\s*boundary="?([^";]+)"?', ...
+                'tokens', 'once', 'ignorecase');
+            if status == 200
+                refused = true;   % Range ignored: the whole value
+                pieceStart = 0;
+                pieces = {body};
+            elseif ~isempty(boundary)
+                [pieceStart, pieces] = parseMultipart(body, boundary{1});
+            else
+                % One range back (some servers merge or drop the others).
+                contentRange = char(r.headers().firstValue('content-range').orElse(''));
+                tok = regexp(contentRange, 'bytes\s+(\d+)-', 'tokens', 'once');
+                if isempty(tok)
+                    refused = true;
+                    return
+                end
+                pieceStart = str2double(tok{1});
+                pieces = {body};
+            end
+            for k = 1:numel(starts)
+                for j = 1:numel(pieces)
+                    first = starts(k) - pieceStart(j) + 1;
+                    last = stops(k) - pieceStart(j);
+                    if first >= 1 && last <= numel(pieces{j})
+                        spans{k} = pieces{j}(first:last);
+                        ok(k) = true;
+                        break
+                    end
+                end
+            end
+            refused = refused || ~all(ok);
+        end
+
+        function client = httpClient(obj)
+            if isempty(obj.client)
+                if startsWith(obj.baseUrl, "https:", 'IgnoreCase', true)
+                    version = 'HTTP_2';   % negotiated via ALPN; 1.1 servers still work
+                else
+                    version = 'HTTP_1_1';   % skip the cleartext h2c upgrade attempt
+                end
+                b = java.net.http.HttpClient.newBuilder();
+                b = b.version(javaMethod('valueOf', 'java.net.http.HttpClient$Version', version));
+                b = b.followRedirects(javaMethod('valueOf', 'java.net.http.HttpClient$Redirect', 'NORMAL'));
+                b = b.connectTimeout(java.time.Duration.ofMillis(round(obj.timeout * 1000)));
+                obj.client = b.build();
+            end
+            client = obj.client;
+        end
+
+        function req = request(obj, key, range)
+            b = java.net.http.HttpRequest.newBuilder(java.net.URI.create(char(obj.url(key))));
+            b = b.timeout(java.time.Duration.ofMillis(round(obj.timeout * 1000)));
+            if ~isempty(range)
+                b = b.header('Range', range);
+            end
+            req = b.GET().build();
+        end
+
+        function u = url(obj, key)
             % Percent-encode characters that would change URL semantics
             % ('#' starts a fragment; .mat-derived stores use '#refs#').
             key = strrep(strrep(strrep(string(key), "%", "%25"), "#", "%23"), " ", "%20");
-            url = obj.baseUrl + "/" + key;
-            headers = {};
-            if ~isempty(rangeHeader)
-                headers = {'Range', rangeHeader};
-            end
-            opts = weboptions('ContentType', 'binary', 'Timeout', 30);
-            if ~isempty(headers)
-                opts.HeaderFields = headers;
+            u = obj.baseUrl + "/" + key;
+        end
+
+        function [data, found] = webFetch(obj, key, range)
+            opts = weboptions('ContentType', 'binary', 'Timeout', obj.timeout);
+            if ~isempty(range)
+                opts.HeaderFields = {'Range', range};
             end
             try
-                data = reshape(webread(url, opts), 1, []);
+                data = reshape(webread(obj.url(key), opts), 1, []);
                 data = uint8(data);
                 found = true;
             catch err
@@ -96,4 +297,115 @@ classdef HttpStore < zarr.stores.Store
             end
         end
     end
+
+    methods (Static, Access = private)
+        function tf = hasHttpClient()
+            persistent available
+            if isempty(available)
+                try
+                    java.lang.Class.forName('java.net.http.HttpClient');
+                    available = true;
+                catch
+                    available = false;
+                end
+            end
+            tf = available;
+        end
+    end
+end
+
+function [data, found] = readResponse(response, key)
+status = response.statusCode();
+data = uint8([]);
+switch status
+    case {200, 206}
+        body = response.body();
+        if ~isempty(body)
+            data = typecast(reshape(int8(body), 1, []), 'uint8');
+        end
+        found = true;
+    case 416
+        found = true;   % range past the end of an existing (empty) value
+    case {403, 404, 410}
+        found = false;
+    otherwise
+        error("zarr:StoreError", "HTTP %d for '%s'.", status, key);
+end
+end
+
+function [starts, stops, owner] = mergeRanges(offsets, lens, gap)
+% Merge byte ranges less than gap apart into spans [starts, stops);
+% range i lies in span owner(i).
+[sorted, order] = sort(offsets);
+ends = sorted + lens(order);
+starts = zeros(1, 0);
+stops = zeros(1, 0);
+owner = zeros(1, numel(offsets));
+for k = 1:numel(sorted)
+    if ~isempty(stops) && sorted(k) <= stops(end) + gap
+        stops(end) = max(stops(end), ends(k));
+    else
+        starts(end + 1) = sorted(k); %#ok<AGROW>
+        stops(end + 1) = ends(k); %#ok<AGROW>
+    end
+    owner(order(k)) = numel(starts);
+end
+end
+
+function [offsets, pieces] = parseMultipart(body, boundary)
+% Parts of a multipart/byteranges body: pieces{j} starts at byte offsets(j)
+% of the value. Part lengths come from their Content-Range headers, so
+% payload bytes that happen to look like a boundary are harmless. The body
+% is searched once for delimiters and header ends; the parse steps through
+% those positions, skipping any that fall inside a part's payload.
+text = char(body);
+delim = ['--' boundary];
+delims = strfind(text, delim);
+blanks = strfind(text, char([13 10 13 10]));
+offsets = zeros(1, 0);
+pieces = {};
+pos = 1;
+d = 1;
+b = 1;
+while true
+    while d <= numel(delims) && delims(d) < pos
+        d = d + 1;
+    end
+    if d > numel(delims)
+        break
+    end
+    head = delims(d) + numel(delim);
+    if head + 1 <= numel(text) && text(head) == '-' && text(head + 1) == '-'
+        break   % closing delimiter
+    end
+    while b <= numel(blanks) && blanks(b) < head
+        b = b + 1;
+    end
+    if b > numel(blanks)
+        break
+    end
+    headers = text(head:blanks(b) - 1);
+    tok = regexp(headers, 'Content-Range:\s*bytes\s+(\d+)-(\d+)', 'tokens', 'once', 'ignorecase');
+    if isempty(tok)
+        break
+    end
+    first = str2double(tok{1});
+    n = str2double(tok{2}) - first + 1;
+    dataStart = blanks(b) + 4;
+    if dataStart + n - 1 > numel(body)
+        break
+    end
+    offsets(end + 1) = first; %#ok<AGROW>
+    pieces{end + 1} = body(dataStart:dataStart + n - 1); %#ok<AGROW>
+    pos = dataStart + n;
+end
+end
+
+function cancelAll(pending)
+% Abandon the requests still in flight when a fetch fails.
+for i = 1:numel(pending)
+    if ~isempty(pending{i})
+        pending{i}.cancel(true);
+    end
+end
 end
@@ -1,53 +1,81 @@
 classdef LocalStore < zarr.stores.Store
     %LOCALSTORE Key/value store over a local directory.
+    %   zarr.stores.LocalStore(root)
+    %   zarr.stores.LocalStore(root, Locking=true, LockTimeout=60)
+    %   zarr.stores.LocalStore(root, Durability="durable", BatchSync=true)
+    %
+    %   Durability sets how set/openWrite publish a value:
+    %     "atomic"  (default) temp file renamed into place: readers never
+    %               see a partial value, but a crash can lose recent writes
+    %     "none"    written straight to the key's file (fastest; readers
+    %               and crashes can observe partial values)
+    %     "durable" as "atomic", plus fsync of the file before the rename
+    %               and of its directory after it
+    %   With BatchSync, "durable" defers the directory fsyncs (and those of
+    %   values updated in place) of one Array.write (batchSync) to its end:
+    %   one fsync per chunk plus one per directory, instead of two per
+    %   chunk. Each temp file is still synced before its rename, so a crash
+    %   inside a batch can lose new values but never publishes a torn one.
+    %   Renames and fsyncs use localfs_mex when built (tools/build_mex.m),
+    %   java.nio otherwise.
+    %
+    %   Reads (get, getPartial, getSuffix) go through localfs_mex too when it
+    %   is built: it keeps up to 64 files open for reading and uses pread,
+    %   so the index and inner-chunk reads of a shard share one open. A
+    %   cached handle is dropped when this process sets or erases the key,
+    %   and reopened when the path has been replaced by another process.
+    %
+    %   With Locking, lockKey takes an exclusive advisory lock (a Java
+    %   FileChannel lock on "<root>/.zarr-locks/<key>.lock", fcntl-based
+    %   on POSIX) so that array writers in separate MATLAB processes
+    %   serialize their read-modify-write of the same chunk or shard.
+    %   Handles in the same MATLAB process wait for each other too. Lock
+    %   files are left in place (deleting them would race with waiting
+    %   writers); the .zarr-locks directory is hidden from list/listDir.
 
     properties (SetAccess = immutable)
         root (1,1) string
+        locking (1,1) logical = false
+        lockTimeout (1,1) double = 60   % seconds
+        durability (1,1) string = "atomic"
+        batchSync (1,1) logical = false
+    end
+
+    properties (Constant, Access = private)
+        LockDir = ".zarr-locks"   % lock files, below root
+    end
+
+    properties (Access = private)
+        syncDepth (1,1) double = 0
+        pendingSync = strings(0, 1)   % files and directories to fsync
     end
 
     methods
-        function obj = LocalStore(root)
+        function obj = LocalStore(root, opts)
+            arguments
+                root
+                opts.Locking (1,1) logical = false
+                opts.LockTimeout (1,1) double {mustBeNonnegative} = 60
+                opts.Durability (1,1) string {mustBeMember(opts.Durability, ["none", "atomic", "durable"])} = "atomic"
+                opts.BatchSync (1,1) logical = false
+            end
             obj.root = string(root);
+            obj.locking = opts.Locking;
+            obj.lockTimeout = opts.LockTimeout;
+            obj.durability = opts.Durability;
+            obj.batchSync = opts.BatchSync;
         end
 
         function [data, found] = get(obj, key)
-            fid = fopen(obj.keyPath(key), 'r');
-            if fid == -1
-                data = uint8([]);
-                found = false;
-                return
-            end
-            cleaner = onCleanup(@() fclose(fid));
-            data = fread(fid, Inf, '*uint8')';
-            found = true;
+            [data, found] = zarr.internal.localfs("pread", obj.keyPath(key), 0, Inf);
         end
 
         function [data, found] = getPartial(obj, key, offset, len)
-            fid = fopen(obj.keyPath(key), 'r');
-            if fid == -1
-                data = uint8([]);
-                found = false;
-                return
-            end
-            cleaner = onCleanup(@() fclose(fid));
-            fseek(fid, offset, 'bof');
-            data = fread(fid, len, '*uint8')';
-            found = true;
+            [data, found] = zarr.internal.localfs("pread", obj.keyPath(key), offset, len);
         end
 
         function [data, found] = getSuffix(obj, key, len)
-            fid = fopen(obj.keyPath(key), 'r');
-            if fid == -1
-                data = uint8([]);
-                found = false;
-                return
-            end
-            cleaner = onCleanup(@() fclose(fid));
-            fseek(fid, 0, 'eof');
-            n = ftell(fid);
-            fseek(fid, max(0, n - len), 'bof');
-            data = fread(fid, len, '*uint8')';
-            found = true;
+            [data, found] = zarr.internal.localfs("tail", obj.keyPath(key), len);
         end
 
         function tf = exists(obj, key)
@@ -55,48 +83,130 @@ classdef LocalStore < zarr.stores.Store
         end
 
         function set(obj, key, data)
+            w = obj.openWrite(key);
+            w.write(data);
+            w.commit();
+        end
+
+        function w = openWrite(obj, key)
             p = obj.keyPath(key);
             d = fileparts(p);
             if strlength(string(d)) > 0 && ~isfolder(d)
                 mkdir(d);
             end
-            % Write to a temp file in the same directory, then move into
+            if obj.durability == "none"
+                zarr.internal.localfs("forget", p);
+                w = zarr.stores.FileValueWriter(p, @(~) [], InPlace=true);
+                return
+            end
+            % Write to a temp file in the same directory, then rename into
             % place so concurrent readers never see partial chunks.
             [~, tmpName] = fileparts(tempname);
             tmp = p + "." + tmpName + ".partial";
-            fid = fopen(tmp, 'w');
-            if fid == -1
-                error("zarr:StoreError", "Cannot write to '%s'.", p);
+            w = zarr.stores.FileValueWriter(tmp, @(t) obj.publish(t, p));
+        end
+
+        function batch = batchSync(obj)
+            if obj.durability ~= "durable" || ~obj.batchSync
+                batch = [];
+                return
             end
-            fwrite(fid, uint8(data(:)'), 'uint8');
-            fclose(fid);
-            movefile(tmp, p, 'f');
+            obj.syncDepth = obj.syncDepth + 1;
+            batch = onCleanup(@() obj.endSyncBatch());
+        end
+
+        function [n, found] = sizeOf(obj, key)
+            d = dir(obj.keyPath(key));
+            found = isscalar(d) && ~d.isdir;
+            if found
+                n = d.bytes;
+            else
+                n = 0;
+            end
+        end
+
+        function tf = canAppend(~)
+            tf = true;
+        end
+
+        function tf = isParallelSafe(~)
+            tf = true;
+        end
+
+        function lock = lockKey(obj, key)
+            if ~obj.locking
+                lock = [];
+                return
+            end
+            p = obj.keyPath(zarr.stores.LocalStore.LockDir + "/" + key) + ".lock";
+            d = fileparts(p);
+            if strlength(string(d)) > 0 && ~isfolder(d)
+                mkdir(d);
+            end
+            raf = java.io.RandomAccessFile(char(p), 'rw');
+            ch = raf.getChannel();
+            deadline = tic;
+            lk = tryLock(ch);
+            while isempty(lk)
+                if toc(deadline) > obj.lockTimeout
+                    raf.close();
+                    error("zarr:StoreError", ...
+                        "Timed out after %g s waiting for the lock on '%s'.", obj.lockTimeout, key);
+                end
+                pause(0.01);
+                lk = tryLock(ch);
+            end
+            lock = onCleanup(@() releaseLock(lk, raf));
+        end
+
+        function offset = appendBytes(obj, key, data)
+            % Not atomic: a concurrent reader may see the value mid-append.
+            fid = obj.openForUpdate(key);
+            cleaner = onCleanup(@() fclose(fid));
+            fseek(fid, 0, 'eof');
+            offset = ftell(fid);
+            fwrite(fid, data, 'uint8');
+            clear cleaner
+            obj.sync(obj.keyPath(key));
+        end
+
+        function writeAt(obj, key, offset, data)
+            fid = obj.openForUpdate(key);
+            cleaner = onCleanup(@() fclose(fid));
+            fseek(fid, offset, 'bof');
+            fwrite(fid, data, 'uint8');
+            clear cleaner
+            obj.sync(obj.keyPath(key));
         end
 
         function erase(obj, key)
             p = obj.keyPath(key);
+            zarr.internal.localfs("forget", p);
             if isfile(p)
                 delete(p);
             end
         end
 
         function ks = list(obj)
-            if ~isfolder(obj.root)
-                ks = string.empty(0, 1);
-                return
+            ks = obj.listPrefix("");
+        end
+
+        function ks = listPrefix(obj, prefix)
+            % Walks only the directory holding the prefix, not the whole
+            % hierarchy, in one localfs_mex call when it is built.
+            prefix = string(prefix);
+            slash = strfind(prefix, "/");
+            if isempty(slash)
+                dirPart = "";
+            else
+                dirPart = extractBefore(prefix, slash(end) + 1);   % keeps the "/"
             end
-            entries = dir(fullfile(obj.root, '**', '*'));
-            entries = entries(~[entries.isdir]);
-            n = numel(entries);
-            ks = strings(n, 1);
-            rootAbs = string(obj.absRoot());
-            for i = 1:n
-                full = string(fullfile(entries(i).folder, entries(i).name));
-                rel = extractAfter(full, strlength(rootAbs));
-                rel = strip(rel, 'left', filesep);
-                ks(i) = strjoin(split(rel, filesep), "/");
+            ks = zarr.internal.localfs("list", obj.keyPath(dirPart));
+            ks = dirPart + ks;
+            if dirPart == ""
+                ks = ks(~startsWith(ks, zarr.stores.LocalStore.LockDir + "/"));
             end
-            ks = sort(ks);
+            ks = sort(ks(startsWith(ks, prefix)));
         end
 
         function [subdirs, files] = listDir(obj, prefix)
@@ -116,22 +226,93 @@ classdef LocalStore < zarr.stores.Store
             names = string({entries.name})';
             isd = [entries.isdir]';
             subdirs = names(isd);
+            if strlength(prefix) == 0
+                subdirs = subdirs(subdirs ~= zarr.stores.LocalStore.LockDir);
+            end
             files = names(~isd);
         end
     end
 
+    methods (Access = protected)
+        function fileOp(~, cmd, varargin)
+            %FILEOP Rename or fsync through zarr.internal.localfs (a seam
+            %   for tests that check the order of durability operations).
+            zarr.internal.localfs(cmd, varargin{:});
+        end
+    end
+
     methods (Access = private)
         function p = keyPath(obj, key)
             p = string(fullfile(obj.root, strjoin(split(string(key), "/"), filesep)));
         end
 
-        function r = absRoot(obj)
-            d = dir(obj.root);
-            if isempty(d)
-                r = obj.root;
-            else
-                r = string(d(1).folder);
+        function publish(obj, tmp, p)
+            % The data is on disk before its name is: a crash, even inside
+            % a batch, leaves either the old value or the complete new one.
+            if obj.durability == "durable"
+                obj.fileOp("fsync", tmp);
+            end
+            obj.fileOp("rename", tmp, p);
+            obj.sync(string(fileparts(p)));
+        end
+
+        function sync(obj, paths)
+            %SYNC fsync paths under "durable" now, or at the end of the
+            %   current batchSync scope.
+            if obj.durability ~= "durable"
+                return
+            end
+            if obj.syncDepth > 0
+                obj.pendingSync = [obj.pendingSync; paths(:)];
+                return
+            end
+            for i = 1:numel(paths)
+                obj.fileOp("fsync", paths(i));
             end
         end
+
+        function endSyncBatch(obj)
+            obj.syncDepth = obj.syncDepth - 1;
+            if obj.syncDepth > 0
+                return
+            end
+            paths = unique(obj.pendingSync, 'stable');
+            obj.pendingSync = strings(0, 1);
+            % files first, then the directories holding their new names
+            isDir = arrayfun(@isfolder, paths);
+            paths = [paths(~isDir); paths(isDir)];
+            for i = 1:numel(paths)
+                if isfile(paths(i)) || isfolder(paths(i))
+                    obj.fileOp("fsync", paths(i));
+                end
+            end
+        end
+
+        function fid = openForUpdate(obj, key)
+            p = obj.keyPath(key);
+            fid = fopen(p, 'r+');
+            if fid == -1
+                error("zarr:StoreError", "Cannot update '%s' in place (missing or not writable).", p);
+            end
+        end
+    end
+end
+
+function lk = tryLock(ch)
+% FileChannel.tryLock, or [] while the lock is held. A lock held through
+% another channel of this JVM (a second handle on the same key) raises
+% OverlappingFileLockException rather than returning null.
+try
+    lk = ch.tryLock();
+catch err
+    if ~contains(err.message, "OverlappingFileLockException")
+        rethrow(err);
     end
+    lk = [];
+end
+end
+
+function releaseLock(lk, raf)
+lk.release();
+raf.close();
 end
@@ -24,6 +24,16 @@ classdef MemoryStore < zarr.stores.Store
             tf = obj.map.isKey(char(key));
         end
 
+        function [n, found] = sizeOf(obj, key)
+            key = char(key);
+            found = obj.map.isKey(key);
+            if found
+                n = numel(obj.map(key));
+            else
+                n = 0;
+            end
+        end
+
         function set(obj, key, data)
             obj.map(char(key)) = uint8(data(:)');
         end
@@ -35,6 +45,14 @@ classdef MemoryStore < zarr.stores.Store
             end
         end
 
+        function eraseMany(obj, keys)
+            if isempty(keys)
+                return
+            end
+            keys = cellstr(keys);
+            obj.map.remove(keys(obj.map.isKey(keys)));
+        end
+
         function ks = list(obj)
             ks = string(obj.map.keys())';
         end
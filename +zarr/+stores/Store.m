@@ -36,5 +36,108 @@ classdef (Abstract) Store < handle
             end
             data = full(max(1, numel(full) - len + 1):end);
         end
+
+        function keys = listPrefix(obj, prefix)
+            %LISTPREFIX Keys starting with prefix, sorted (string column).
+            %   Use "a/b/" for everything below node a/b. Default filters
+            %   list; LocalStore walks only the directory holding prefix.
+            keys = obj.list();
+            keys = sort(reshape(keys(startsWith(keys, string(prefix))), [], 1));
+        end
+
+        function [parts, found] = getRanges(obj, key, offsets, lens)
+            %GETRANGES Several byte ranges of one value: parts{i} holds
+            %   lens(i) bytes from 0-based offsets(i). Default loops over
+            %   getPartial; HttpStore sends one multi-range request.
+            parts = cell(1, numel(offsets));
+            found = true;
+            for i = 1:numel(offsets)
+                [parts{i}, found] = obj.getPartial(key, double(offsets(i)), double(lens(i)));
+                if ~found
+                    return
+                end
+            end
+        end
+
+        function [n, found] = sizeOf(obj, key)
+            %SIZEOF Size of a value in bytes (0 and found=false if absent).
+            [full, found] = obj.get(key);
+            n = numel(full);
+        end
+
+        function [values, found] = getMany(obj, keys)
+            %GETMANY Read several values: values{i} and found(i) for keys(i).
+            %   Default loops over get; stores override where the backend
+            %   can fetch a batch in one round trip.
+            values = cell(1, numel(keys));
+            found = false(1, numel(keys));
+            for i = 1:numel(keys)
+                [values{i}, found(i)] = obj.get(keys(i));
+            end
+        end
+
+        function setMany(obj, keys, values)
+            %SETMANY Write values{i} under keys(i). Default loops over set.
+            for i = 1:numel(keys)
+                obj.set(keys(i), values{i});
+            end
+        end
+
+        function eraseMany(obj, keys)
+            %ERASEMANY Erase several keys (missing keys are ignored).
+            %   Default loops over erase; stores override with a batched
+            %   delete where the backend has one.
+            for i = 1:numel(keys)
+                obj.erase(keys(i));
+            end
+        end
+
+        function w = openWrite(obj, key)
+            %OPENWRITE Start a streaming write of one value: returns a
+            %   zarr.stores.ValueWriter (write, patch, commit, abort). The
+            %   value becomes visible on commit. Default buffers in memory
+            %   and calls set; subclasses stream to their backing medium.
+            w = zarr.stores.ValueWriter(obj, key);
+        end
+
+        function tf = canAppend(obj) %#ok<MANU>
+            %CANAPPEND True if appendBytes/writeAt modify values in place.
+            %   Enables in-place shard updates (Array.inPlaceShardUpdates).
+            tf = false;
+        end
+
+        function tf = isParallelSafe(obj) %#ok<MANU>
+            %ISPARALLELSAFE True if copies of this store sent to pool workers
+            %   write to the same underlying data, so writes to distinct keys
+            %   may run concurrently (Array.writeAsync). In-memory stores
+            %   are copied per worker and are not.
+            tf = false;
+        end
+
+        function lock = lockKey(obj, key) %#ok<INUSD>
+            %LOCKKEY Exclusive lock on key for a read-modify-write; released
+            %   when the returned object is cleared. Default: no locking
+            %   (returns []); LocalStore locks across processes when
+            %   created with Locking=true.
+            lock = [];
+        end
+
+        function batch = batchSync(obj) %#ok<MANU>
+            %BATCHSYNC Scope grouping the durability work (fsyncs) of the
+            %   values written until the returned object is cleared; an
+            %   Array.write holds one. Default: nothing to group (returns []).
+            batch = [];
+        end
+
+        function offset = appendBytes(obj, key, data) %#ok<STOUT,INUSD>
+            %APPENDBYTES Append data to an existing value; returns the
+            %   0-based offset at which it was written.
+            error("zarr:StoreError", "%s does not support in-place appends.", class(obj));
+        end
+
+        function writeAt(obj, key, offset, data) %#ok<INUSD>
+            %WRITEAT Overwrite bytes of an existing value at a 0-based offset.
+            error("zarr:StoreError", "%s does not support in-place writes.", class(obj));
+        end
     end
 end
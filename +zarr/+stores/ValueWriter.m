@@ -0,0 +1,105 @@
+classdef ValueWriter < handle
+    %VALUEWRITER Streaming write of one store value (Store.openWrite).
+    %   w.write(bytes)           append bytes at the current position
+    %   w.patch(offset, bytes)   overwrite already-written bytes (0-based)
+    %   w.commit()               publish the value under its key
+    %   w.abort()                discard it (also on delete without commit)
+    %
+    %   This default buffers the parts in memory and calls store.set on
+    %   commit; stores that can stream to their backing medium return a
+    %   subclass (zarr.stores.FileValueWriter). With an empty store the
+    %   writer is a plain byte buffer read back with contents().
+
+    properties (SetAccess = private)
+        position (1,1) double = 0   % bytes written so far
+    end
+
+    properties (Access = private)
+        store
+        key
+        parts = {}
+        patches = {}     % {offset, bytes} pairs applied by contents()
+    end
+
+    properties (Access = protected)
+        isDone (1,1) logical = false
+    end
+
+    methods
+        function obj = ValueWriter(store, key)
+            if nargin > 0
+                obj.store = store;
+                obj.key = key;
+            end
+        end
+
+        function write(obj, data)
+            obj.assertOpen();
+            obj.writeImpl(data);
+            obj.position = obj.position + numel(data);
+        end
+
+        function patch(obj, offset, data)
+            obj.assertOpen();
+            if offset < 0 || offset + numel(data) > obj.position
+                error("zarr:StoreError", ...
+                    "patch of %d bytes at offset %d is outside the %d bytes written.", ...
+                    numel(data), offset, obj.position);
+            end
+            obj.patchImpl(offset, data);
+        end
+
+        function commit(obj)
+            obj.assertOpen();
+            obj.isDone = true;
+            obj.commitImpl();
+        end
+
+        function abort(obj)
+            if obj.isDone
+                return
+            end
+            obj.isDone = true;
+            obj.abortImpl();
+        end
+
+        function bytes = contents(obj)
+            bytes = [uint8.empty(1, 0), obj.parts{:}];
+            for i = 1:numel(obj.patches)
+                p = obj.patches{i};
+                bytes(p{1} + 1:p{1} + numel(p{2})) = p{2};
+            end
+        end
+
+        function delete(obj)
+            obj.abort();
+        end
+    end
+
+    methods (Access = protected)
+        function writeImpl(obj, data)
+            obj.parts{end + 1} = reshape(uint8(data), 1, []);
+        end
+
+        function patchImpl(obj, offset, data)
+            obj.patches{end + 1} = {offset, reshape(uint8(data), 1, [])};
+        end
+
+        function commitImpl(obj)
+            obj.store.set(obj.key, obj.contents());
+            obj.parts = {};
+        end
+
+        function abortImpl(obj)
+            obj.parts = {};
+        end
+    end
+
+    methods (Access = private)
+        function assertOpen(obj)
+            if obj.isDone
+                error("zarr:StoreError", "Value writer is already committed or aborted.");
+            end
+        end
+    end
+end
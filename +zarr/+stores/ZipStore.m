@@ -6,6 +6,10 @@ classdef ZipStore < zarr.stores.Store
     %                                          the file is written by close()
     %                                          (also called by the destructor).
     %
+    %   Values written through openWrite (streamed shards) are spilled to
+    %   temporary files until close() copies them into the archive, so they
+    %   never need to fit in memory.
+    %
     %   Matches zarr-python's ZipStore layout: node paths as plain entry names.
 
     properties (SetAccess = immutable)
@@ -15,7 +19,8 @@ classdef ZipStore < zarr.stores.Store
 
     properties (Access = private)
         zf              % java.util.zip.ZipFile (read mode)
-        pending         % containers.Map (write mode)
+        pending         % containers.Map (write mode): uint8 value, or the
+                        % string path of a spilled value
         isClosed (1,1) logical = false
     end
 
@@ -50,6 +55,16 @@ classdef ZipStore < zarr.stores.Store
                 found = obj.pending.isKey(char(key));
                 if found
                     data = obj.pending(char(key));
+                    if isstring(data)   % spilled to a temp file
+                        fid = fopen(data, 'r');
+                        if fid == -1
+                            error("zarr:StoreError", "Cannot read the spilled value of '%s' from '%s'.", ...
+                                key, data);
+                        end
+                        closer = onCleanup(@() fclose(fid));
+                        data = fread(fid, Inf, '*uint8')';
+                        clear closer
+                    end
                 else
                     data = uint8([]);
                 end
@@ -76,13 +91,53 @@ classdef ZipStore < zarr.stores.Store
             end
         end
 
+        function [n, found] = sizeOf(obj, key)
+            %SIZEOF From the pending value or spill file, or the archive's
+            %   central directory; the value itself is not read.
+            obj.assertOpen();
+            n = 0;
+            if obj.mode == "w"
+                found = obj.pending.isKey(char(key));
+                if found
+                    data = obj.pending(char(key));
+                    if isstring(data)   % spilled to a temp file
+                        d = dir(data);
+                        if ~isscalar(d)
+                            error("zarr:StoreError", "Cannot read the spilled value of '%s' from '%s'.", ...
+                                key, data);
+                        end
+                        n = d.bytes;
+                    else
+                        n = numel(data);
+                    end
+                end
+                return
+            end
+            entry = obj.zf.getEntry(char(key));
+            found = ~isempty(entry);
+            if found
+                n = double(entry.getSize());
+                if n < 0   % size not recorded
+                    n = numel(obj.get(key));
+                end
+            end
+        end
+
         function set(obj, key, data)
             obj.assertWritable();
+            obj.dropSpill(key);
             obj.pending(char(key)) = uint8(data(:)');
         end
 
+        function w = openWrite(obj, key)
+            obj.assertWritable();
+            w = zarr.stores.FileValueWriter(string(tempname) + ".zipentry", ...
+                @(tmp) obj.adoptSpill(key, tmp));
+        end
+
         function erase(obj, key)
             obj.assertWritable();
+            obj.dropSpill(key);
             if obj.pending.isKey(char(key))
                 obj.pending.remove(char(key));
             end
@@ -140,13 +195,24 @@ classdef ZipStore < zarr.stores.Store
                 for i = 1:numel(keys)
                     zos.putNextEntry(java.util.zip.ZipEntry(char(keys(i))));
                     data = obj.pending(char(keys(i)));
-                    if ~isempty(data)
+                    if isstring(data)
+                        fis = java.io.FileInputStream(char(data));
+                        try
+                            org.apache.commons.io.IOUtils.copy(fis, zos);
+                        catch copyErr
+                            fis.close();   % else the spill file stays open
+                            rethrow(copyErr);
+                        end
+                        fis.close();
+                    elseif ~isempty(data)
                         zos.write(typecast(uint8(data), 'int8'));
                     end
                     zos.closeEntry();
                 end
                 zos.close();
+                obj.dropAllSpills();
             catch err
+                obj.dropAllSpills();
                 try %#ok<TRYNC> best-effort cleanup; must not mask the original error
                     zos.close();
                 end
@@ -173,6 +239,27 @@ classdef ZipStore < zarr.stores.Store
     end
 
     methods (Access = private)
+        function adoptSpill(obj, key, tmp)
+            obj.dropSpill(key);
+            obj.pending(char(key)) = string(tmp);
+        end
+
+        function dropSpill(obj, key)
+            if obj.pending.isKey(char(key))
+                v = obj.pending(char(key));
+                if isstring(v) && isfile(v)
+                    delete(v);
+                end
+            end
+        end
+
+        function dropAllSpills(obj)
+            keys = obj.pending.keys();
+            for i = 1:numel(keys)
+                obj.dropSpill(keys{i});
+            end
+        end
+
         function assertOpen(obj)
             if obj.isClosed
                 error("zarr:StoreError", "ZipStore '%s' is closed.", obj.path);
@@ -0,0 +1,197 @@
+classdef Appender < handle
+    %APPENDER Streaming append session along one dimension of a zarr.Array.
+    %   ap = z.openAppender(Dim=1, MetadataInterval=1)
+    %   ap.append(data)   add data at the end of dimension Dim
+    %   ap.flush()        store the partial tail chunk and commit the shape
+    %   ap.close()        flush and end the session (also on delete)
+    %
+    %   Appended data is held in memory until it completes an outer chunk
+    %   (a shard, for sharded arrays) along Dim; complete chunks are written
+    %   whole and never read back. A partial tail chunk is stored only on
+    %   flush/close. An existing partial tail is loaded when the session
+    %   opens, so appends always start at a chunk boundary.
+    %
+    %   The shape in zarr.json is committed by any append that comes at
+    %   least MetadataInterval seconds after the last commit and finds data
+    %   stored beyond it (0: after every stored chunk, Inf: only on
+    %   flush/close). It only covers data already in the store, so readers
+    %   never see rows that are still buffered as fill values. The in-memory
+    %   shape of the array grows with every append. If storing or committing
+    %   fails, the session closes and the in-memory shape goes back to the
+    %   committed one; the error is raised (or, from delete, warned about).
+
+    properties (SetAccess = immutable)
+        array
+        dim (1,1) double
+        metadataInterval (1,1) double
+    end
+
+    properties (SetAccess = private)
+        extent (1,1) double            % length along dim, including buffered data
+        committedExtent (1,1) double   % length recorded in zarr.json
+    end
+
+    properties (Access = private)
+        tail                        % data from tailStart+1 to extent along dim
+        tailStart (1,1) double      % 0-based, always a multiple of the chunk length
+        storedExtent (1,1) double   % length whose data is in the store
+        lastCommit
+        isClosed (1,1) logical = false
+    end
+
+    methods
+        function obj = Appender(array, opts)
+            arguments
+                array (1,1) zarr.Array
+                opts.Dim (1,1) double {mustBeInteger, mustBePositive} = 1
+                opts.MetadataInterval (1,1) double {mustBeNonnegative} = 1
+            end
+            R = numel(array.shape);
+            if R == 0
+                error("zarr:ShapeMismatch", "Cannot append to a rank-0 array.");
+            end
+            if opts.Dim > R
+                error("zarr:ShapeMismatch", ...
+                    "Append dimension %d exceeds the array rank %d.", opts.Dim, R);
+            end
+            obj.array = array;
+            obj.dim = opts.Dim;
+            obj.metadataInterval = opts.MetadataInterval;
+
+            d = obj.dim;
+            n = array.shape(d);
+            obj.tailStart = floor(n / array.chunkShape(d)) * array.chunkShape(d);
+            start = ones(1, R);
+            start(d) = obj.tailStart + 1;
+            count = array.shape;
+            count(d) = n - obj.tailStart;
+            obj.tail = array.read(start, count);
+            obj.extent = n;
+            obj.storedExtent = n;
+            obj.committedExtent = n;
+            obj.lastCommit = tic;
+        end
+
+        function append(obj, data)
+            obj.assertOpen();
+            z = obj.array;
+            R = numel(z.shape);
+            d = obj.dim;
+            if R == 1
+                data = data(:);
+                n = numel(data);
+            else
+                sz = size(data, 1:R);
+                other = [1:d - 1, d + 1:R];
+                if any(sz(other) ~= z.shape(other))
+                    error("zarr:ShapeMismatch", ...
+                        "Appended data of size [%s] does not match the array shape [%s] outside dimension %d.", ...
+                        join(string(sz), ","), join(string(z.shape), ","), d);
+                end
+                n = sz(d);
+            end
+            if n == 0
+                return
+            end
+            obj.tail = cat(d, obj.tail, z.coerce(data));
+            obj.extent = obj.extent + n;
+            shape = z.shape;
+            shape(d) = obj.extent;
+            z.setShapeUncommitted(shape);
+
+            c = z.chunkShape(d);
+            held = size(obj.tail, d);
+            nFull = floor(held / c) * c;
+            try
+                if nFull > 0
+                    idx = repmat({':'}, 1, max(R, 2));
+                    idx{d} = 1:nFull;
+                    obj.storeTail(obj.tail(idx{:}));
+                    idx{d} = nFull + 1:held;
+                    obj.tail = obj.tail(idx{:});
+                    obj.tailStart = obj.tailStart + nFull;
+                    obj.storedExtent = max(obj.storedExtent, obj.tailStart);
+                end
+                % checked on every append, so stored chunks get committed
+                % even while later appends only fill the buffer
+                if obj.storedExtent > obj.committedExtent && ...
+                        toc(obj.lastCommit) >= obj.metadataInterval
+                    obj.commit(obj.storedExtent);
+                end
+            catch err
+                obj.abandon();
+                rethrow(err);
+            end
+        end
+
+        function flush(obj)
+            obj.assertOpen();
+            try
+                if obj.storedExtent < obj.extent
+                    obj.storeTail(obj.tail);
+                    obj.storedExtent = obj.extent;
+                end
+                obj.commit(obj.extent);
+            catch err
+                obj.abandon();
+                rethrow(err);
+            end
+        end
+
+        function close(obj)
+            if obj.isClosed
+                return
+            end
+            obj.flush();
+            obj.isClosed = true;
+        end
+
+        function delete(obj)
+            if isempty(obj.lastCommit)
+                return  % constructor failed
+            end
+            try % destructor must not throw, but the failure must be visible
+                obj.close();
+            catch err
+                warning("zarr:StoreError", ...
+                    "Failed to flush Appender for '/%s' during destruction: %s", ...
+                    obj.array.path, err.message);
+            end
+        end
+    end
+
+    methods (Access = private)
+        function storeTail(obj, block)
+            start = ones(1, numel(obj.array.shape));
+            start(obj.dim) = obj.tailStart + 1;
+            obj.array.write(block, start);
+        end
+
+        function commit(obj, n)
+            if n ~= obj.committedExtent
+                shape = obj.array.shape;
+                shape(obj.dim) = n;
+                obj.array.writeMetadataWithShape(shape);
+                obj.committedExtent = n;
+            end
+            obj.lastCommit = tic;
+        end
+
+        function abandon(obj)
+            % A store error ends the session: the array's in-memory shape
+            % goes back to the committed one, matching zarr.json, and the
+            % buffered data is dropped.
+            shape = obj.array.shape;
+            shape(obj.dim) = obj.committedExtent;
+            obj.array.setShapeUncommitted(shape);
+            obj.tail = [];
+            obj.isClosed = true;
+        end
+
+        function assertOpen(obj)
+            if obj.isClosed
+                error("zarr:StoreError", "Appender for '/%s' is closed.", obj.array.path);
+            end
+        end
+    end
+end
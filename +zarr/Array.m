@@ -1,4 +1,4 @@
-classdef Array < handle & matlab.mixin.indexing.RedefinesParen
+classdef Array < zarr.internal.MetadataBatching & matlab.mixin.indexing.RedefinesParen
     %ARRAY A Zarr v3 array. Supports MATLAB paren indexing for region I/O.
     %
     %   Rank mapping: a rank-1 Zarr array is a MATLAB column vector; a rank-0
@@ -9,6 +9,14 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
         store
         path (1,1) string
         meta
+
+        % Bytes and chunks written through this handle since creation or
+        % resetWriteStats: requestedBytes (data passed to write),
+        % storedBytes/chunksStored (values sent to the store) and
+        % skippedBytes/chunksSkipped (unchanged values, skipUnchanged).
+        % Writes run on pool workers are not counted.
+        writeStats = struct('requestedBytes', 0, 'storedBytes', 0, ...
+            'chunksStored', 0, 'skippedBytes', 0, 'chunksSkipped', 0)
     end
 
     properties
@@ -16,6 +24,42 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
         % entirely the fill value are not stored (and are deleted on
         % overwrite); readers see the fill value either way.
         writeEmptyChunks (1,1) logical = false
+
+        % When true and the store can append in place (LocalStore), partial
+        % writes to an existing shard append only the inner chunks they
+        % touch and rewrite the index, instead of rewriting the shard.
+        % Superseded inner chunks stay behind as dead space until it
+        % exceeds shardCompactionRatio times the live bytes; the next write
+        % then rewrites the shard densely. Readers of a shard being updated
+        % in place may observe it mid-append (the whole-shard rewrite is
+        % atomic on LocalStore; this mode is not).
+        inPlaceShardUpdates (1,1) logical = false
+        shardCompactionRatio (1,1) double {mustBeNonnegative} = 1
+
+        % writeAsync blocks the caller only while more than asyncMaxBytes
+        % of queued data is unwritten.
+        asyncMaxBytes (1,1) double {mustBePositive} = 256 * 2^20
+
+        % When true, a chunk (shard) whose encoded bytes equal the stored
+        % value is not written again, so idempotent re-runs leave files,
+        % caches and backups untouched. Costs a size check per chunk and a
+        % read of same-sized values; shards are then encoded in memory.
+        skipUnchanged (1,1) logical = false
+    end
+
+    properties (Transient)
+        % Pools are not saved or sent to workers with the array: a copy on
+        % a worker (writeAsync, zarr.parallelWrite, zarr.transcode) runs
+        % serially.
+
+        % writeAsync runs on asyncPool (default: backgroundPool; codecs that
+        % use Java, such as gzip, need a process pool).
+        asyncPool = []
+
+        % Pool for encoding and decoding the inner chunks of whole shards in
+        % parallel (empty: serial). Thread pools cannot run Java-based
+        % codecs such as gzip.
+        codecPool = []
     end
 
     properties (Dependent)
@@ -31,10 +75,14 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
         info
     end
 
+    properties (Access = private, Transient)
+        writeQueue = []
+    end
+
     methods
         function obj = Array(store, path, meta)
-            obj.store = store;
             obj.path = zarr.internal.normalize_path(path);
+            obj.store = zarr.internal.StagedChunkStore.wrap(store, obj.path, meta);
             obj.meta = meta;
             obj.info = zarr.internal.dtype_info(meta.dataType, meta.dataTypeConfig);
             obj.pipeline = zarr.codecs.Pipeline(meta.codecs, obj.info, ...
@@ -52,6 +100,7 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
         % ------------------------------------------------------------------
         % Core region I/O (1-based start)
         function out = read(obj, start, count)
+            obj.wait();
             R = numel(obj.meta.shape);
             if nargin < 2, start = ones(1, R); end
             if nargin < 3, count = obj.meta.shape - start + 1; end
@@ -69,25 +118,34 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
                 zarr.internal.mshape(count), obj.info);
             parts = zarr.internal.chunk_intersections(start - 1, count, obj.meta.chunkShape);
             sh = obj.pipeline.soleSharding();
-            for t = 1:numel(parts)
-                p = parts(t);
-                key = obj.chunkStoreKey(p.coords);
-                if ~isempty(sh)
-                    out = obj.readFromShard(sh, key, p, out);
-                    continue
+            if ~isempty(sh)
+                for t = 1:numel(parts)
+                    out = obj.readFromShard(sh, obj.chunkStoreKey(parts(t).coords), parts(t), out);
                 end
-                [bytes, found] = obj.store.get(key);
-                if ~found
-                    continue  % output is pre-filled with fill value
+                return
+            end
+            % Chunks are fetched with getMany, 64 at a time, so stores that
+            % can overlap requests (HttpStore) do.
+            for first = 1:64:numel(parts)
+                batch = parts(first:min(first + 63, numel(parts)));
+                keys = strings(numel(batch), 1);
+                for t = 1:numel(batch)
+                    keys(t) = obj.chunkStoreKey(batch(t).coords);
+                end
+                [values, found] = obj.store.getMany(keys);
+                for t = find(found)   % missing chunks keep the fill value
+                    p = batch(t);
+                    chunk = obj.pipeline.decode(values{t}, obj.codecPool);
+                    values{t} = [];
+                    src = zarr.internal.region_subs(p.inStart, p.inCount);
+                    dst = zarr.internal.region_subs(p.outStart, p.inCount);
+                    out(dst{:}) = chunk(src{:});
                 end
-                chunk = obj.pipeline.decode(bytes);
-                src = subsFor(p.inStart, p.inCount);
-                dst = subsFor(p.outStart, p.inCount);
-                out(dst{:}) = chunk(src{:});
             end
         end
 
         function write(obj, data, start)
+            obj.wait();
             R = numel(obj.meta.shape);
             if nargin < 3, start = ones(1, R); end
             start = reshape(double(start), 1, []);
@@ -96,69 +154,104 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
                 obj.writeScalar(data);
                 return
             end
-
-            if R == 1
-                % Warn only when flattening interleaves, i.e. 2+ non-singleton
-                % dimensions; degenerate vectors like 1x1xN squeeze losslessly.
-                if sum(size(data) > 1) > 1
-                    warning("zarr:ShapeFlattened", ...
-                        "Data with %d dimensions is being flattened to a column vector for a rank-1 array write.", ...
-                        ndims(data));
-                end
-                count = numel(data);
-                data = data(:);
-            else
-                count = size(data, 1:R);
-                if numel(data) ~= prod(count)
-                    error("zarr:ShapeMismatch", ...
-                        "Data with %d dimensions cannot be written to a rank-%d array.", ndims(data), R);
-                end
-            end
-            obj.validateRegion(start, count);
-            data = obj.coerce(data);
+            [data, count] = obj.normalizeWrite(data, start);
+            obj.writeStats.requestedBytes = obj.writeStats.requestedBytes + ...
+                prod(count) * obj.info.itemsize;
 
             cs = obj.meta.chunkShape;
             parts = zarr.internal.chunk_intersections(start - 1, count, cs);
+            sh = obj.pipeline.soleSharding();
+            inPlace = ~isempty(sh) && obj.inPlaceShardUpdates && obj.store.canAppend();
+            batch = obj.store.batchSync(); %#ok<NASGU> durability work done on return
             for t = 1:numel(parts)
-                p = parts(t);
-                key = obj.chunkStoreKey(p.coords);
-                srcSubs = subsFor(p.outStart, p.inCount);  % region within data
-                coversChunk = all(p.inStart == 0 & p.inCount == cs);
-                if coversChunk
-                    chunk = reshape(data(srcSubs{:}), zarr.internal.mshape(cs));
-                else
-                    [bytes, found] = obj.store.get(key);
-                    if found
-                        chunk = obj.pipeline.decode(bytes);
-                    else
-                        chunk = zarr.internal.fill_array(obj.meta.fillValue, ...
-                            zarr.internal.mshape(cs), obj.info);
-                    end
-                    dstSubs = subsFor(p.inStart, p.inCount);
-                    chunk(dstSubs{:}) = data(srcSubs{:});
-                end
-                if ~obj.writeEmptyChunks && isequaln(chunk, ...
-                        zarr.internal.fill_array(obj.meta.fillValue, size(chunk), obj.info))
-                    obj.store.erase(key);
-                else
-                    obj.store.set(key, obj.pipeline.encode(chunk));
-                end
+                obj.writePart(sh, inPlace, parts(t), data);
+            end
+        end
+
+        function writeAsync(obj, data, start)
+            %WRITEASYNC Region write that returns once the data is queued;
+            %   chunks are encoded and stored on asyncPool. wait() blocks
+            %   until every queued write is stored and raises their errors;
+            %   read, write and resize wait first, and an array cleared
+            %   before wait() waits and warns about failures. Stores that
+            %   are not parallel-safe (Store.isParallelSafe), rank-0 arrays
+            %   and sessions without a pool write synchronously.
+            R = numel(obj.meta.shape);
+            if nargin < 3, start = ones(1, R); end
+            start = reshape(double(start), 1, []);
+            q = obj.asyncQueue();
+            if R == 0 || isempty(q)
+                obj.write(data, start);
+                return
+            end
+            [data, count] = obj.normalizeWrite(data, start);
+            parts = zarr.internal.chunk_intersections(start - 1, count, obj.meta.chunkShape);
+            keys = strings(numel(parts), 1);
+            for t = 1:numel(parts)
+                keys(t) = obj.chunkStoreKey(parts(t).coords);
+            end
+            q.submit(obj, data, start, keys);
+        end
+
+        function n = writeFrom(obj, producer, varargin)
+            %WRITEFROM Overwrite the whole array block by block:
+            %   producer(start, count) is called for each chunk- or
+            %   shard-aligned block (zarr.parallelWrite; Pool, BlockShape
+            %   and MaxInFlight pass through). Returns the number of blocks.
+            n = zarr.parallelWrite(obj, producer, varargin{:});
+        end
+
+        function wait(obj)
+            %WAIT Block until all writeAsync writes are stored; raises
+            %   zarr:StoreError (with the worker error as cause) if any failed.
+            if ~isempty(obj.writeQueue)
+                obj.writeQueue.wait();
             end
         end
 
+        function refresh(obj)
+            %REFRESH Re-read zarr.json, picking up metadata changed through
+            %   another handle or process (resize, zarr.transcode).
+            obj.wait();
+            [bytes, found] = obj.store.get(obj.metaStoreKey());
+            if ~found
+                error("zarr:NodeNotFound", "No Zarr v3 node found at '%s'.", obj.path);
+            end
+            meta = zarr.metadata.ArrayMetadata.fromJsonText(native2unicode(bytes, 'UTF-8'));
+            obj.store = zarr.internal.StagedChunkStore.wrap(obj.store, obj.path, meta);
+            obj.meta = meta;
+            obj.info = zarr.internal.dtype_info(meta.dataType, meta.dataTypeConfig);
+            obj.pipeline = zarr.codecs.Pipeline(meta.codecs, obj.info, ...
+                meta.chunkShape, meta.fillValue);
+        end
+
+        function resetWriteStats(obj)
+            %RESETWRITESTATS Zero the writeStats counters.
+            obj.writeStats = struct('requestedBytes', 0, 'storedBytes', 0, ...
+                'chunksStored', 0, 'skippedBytes', 0, 'chunksSkipped', 0);
+        end
+
         function resize(obj, newShape)
             %RESIZE Change the array shape. Chunks fully outside the new shape
-            %   are deleted (matching zarr-python).
+            %   are deleted (matching zarr-python). Inside a metadata batch
+            %   only growing is allowed: the deletions could not be rolled
+            %   back.
             newShape = reshape(double(newShape), 1, []);
             R = numel(obj.meta.shape);
             if numel(newShape) ~= R
                 error("zarr:ShapeMismatch", "resize cannot change array rank.");
             end
+            obj.wait();
             old = obj.meta.shape;
+            if any(newShape < old) && obj.inMetadataBatch()
+                error("zarr:UnsupportedFeature", ...
+                    "Cannot shrink '/%s' inside a metadata batch; resize after committing it.", ...
+                    obj.path);
+            end
             obj.meta.shape = newShape;
             obj.writeMetadata();
             if any(newShape < old)
-                obj.deleteOutOfBoundsChunks();
+                obj.deleteOutOfBoundsChunks(old);
             end
         end
 
@@ -183,6 +276,31 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
             obj.write(data, start);
         end
 
+        function w = openWriter(obj, opts)
+            %OPENWRITER Start a buffered write session (zarr.ShardWriter) on
+            %   a sharded array: small writes accumulate as encoded inner
+            %   chunks and each shard is written once.
+            %   w = z.openWriter(MaxBufferBytes=256*2^20)
+            arguments
+                obj
+                opts.MaxBufferBytes (1,1) double {mustBePositive} = 256 * 2^20
+            end
+            w = zarr.ShardWriter(obj, MaxBufferBytes=opts.MaxBufferBytes);
+        end
+
+        function ap = openAppender(obj, opts)
+            %OPENAPPENDER Start a streaming append session (zarr.Appender):
+            %   data accumulates until it completes a chunk along Dim, and
+            %   the shape is committed every MetadataInterval seconds.
+            %   ap = z.openAppender(Dim=1, MetadataInterval=1)
+            arguments
+                obj
+                opts.Dim (1,1) double {mustBeInteger, mustBePositive} = 1
+                opts.MetadataInterval (1,1) double {mustBeNonnegative} = 1
+            end
+            ap = zarr.Appender(obj, Dim=opts.Dim, MetadataInterval=opts.MetadataInterval);
+        end
+
         function setAttr(obj, name, value)
             obj.meta.attributes.(name) = value;
             obj.writeMetadata();
@@ -261,6 +379,25 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
         end
     end
 
+    % ----------------------------------------------------------------------
+    % zarr.json (batched through zarr.internal.MetadataBatching)
+    methods (Access = protected)
+        function writeMetadata(obj)
+            if obj.deferMetadataWrite()
+                return
+            end
+            obj.store.set(obj.metaStoreKey(), unicode2native(char(obj.meta.toJsonText()), 'UTF-8'));
+        end
+
+        function m = metadataSnapshot(obj)
+            m = obj.meta;
+        end
+
+        function restoreMetadata(obj, m)
+            obj.meta = m;
+        end
+    end
+
     % ----------------------------------------------------------------------
     % Paren indexing
     methods (Access = protected)
@@ -349,13 +486,36 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
     end
 
     % ----------------------------------------------------------------------
-    methods (Access = private)
-        function key = metaStoreKey(obj)
-            if strlength(obj.path) == 0
-                key = "zarr.json";
+    % Building blocks shared with the session writers
+    methods (Access = {?zarr.ShardWriter, ?zarr.Appender})
+        function sh = shardingCodec(obj)
+            %SHARDINGCODEC The bound ShardingCodec when it is the whole chain, else [].
+            sh = obj.pipeline.soleSharding();
+        end
+
+        function [data, count] = normalizeWrite(obj, data, start)
+            %NORMALIZEWRITE Shape-check, validate and coerce data for a
+            %   region write at 1-based start (rank >= 1).
+            R = numel(obj.meta.shape);
+            if R == 1
+                % Warn only when flattening interleaves, i.e. 2+ non-singleton
+                % dimensions; degenerate vectors like 1x1xN squeeze losslessly.
+                if sum(size(data) > 1) > 1
+                    warning("zarr:ShapeFlattened", ...
+                        "Data with %d dimensions is being flattened to a column vector for a rank-1 array write.", ...
+                        ndims(data));
+                end
+                count = numel(data);
+                data = data(:);
             else
-                key = obj.path + "/zarr.json";
+                count = size(data, 1:R);
+                if numel(data) ~= prod(count)
+                    error("zarr:ShapeMismatch", ...
+                        "Data with %d dimensions cannot be written to a rank-%d array.", ndims(data), R);
+                end
             end
+            obj.validateRegion(start, count);
+            data = obj.coerce(data);
         end
 
         function key = chunkStoreKey(obj, coords)
@@ -367,10 +527,263 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
             end
         end
 
-        function writeMetadata(obj)
-            obj.store.set(obj.metaStoreKey(), unicode2native(char(obj.meta.toJsonText()), 'UTF-8'));
+        function I = readShardIndex(obj, sh, key)
+            %READSHARDINDEX Decoded index of a stored shard, or [] if absent.
+            if sh.indexLocation == "start"
+                [ib, found] = obj.store.getPartial(key, 0, sh.indexLen);
+            else
+                [ib, found] = obj.store.getSuffix(key, sh.indexLen);
+            end
+            if ~found
+                I = [];
+                return
+            end
+            if numel(ib) < sh.indexLen
+                error("zarr:CodecError", "Shard '%s' is smaller than its index.", key);
+            end
+            I = sh.indexPipeline.decode(ib);
+        end
+
+        function chunk = readInnerChunk(obj, sh, key, off, len)
+            [cb, found] = obj.store.getPartial(key, double(off), double(len));
+            if ~found || numel(cb) < double(len)
+                error("zarr:CodecError", "Shard '%s' is truncated.", key);
+            end
+            chunk = sh.innerPipeline.decode(cb);
         end
 
+        function [ts, blobs] = encodeTouchedInnerChunks(obj, sh, p, data, readOld, present)
+            %ENCODETOUCHEDINNERCHUNKS Encode the inner chunks of shard part p
+            %   after applying the write. ts are 1-based C-order inner chunk
+            %   indices; blobs{k} is empty where the result is all fill (such
+            %   inner chunks are elided, as in a full shard encode). readOld(t)
+            %   decodes an existing inner chunk; it is only called for
+            %   partially covered chunks that are present.
+            innerShape = zarr.internal.mshape(sh.chunkShape);
+            fillChunk = zarr.internal.fill_array(obj.meta.fillValue, innerShape, obj.info);
+            innerParts = zarr.internal.chunk_intersections(p.inStart, p.inCount, sh.chunkShape);
+            ts = zeros(1, numel(innerParts));
+            blobs = cell(1, numel(innerParts));
+            for k = 1:numel(innerParts)
+                ip = innerParts(k);
+                t = zarr.codecs.ShardingCodec.ravelC(ip.coords, sh.nChunks) + 1;
+                ts(k) = t;
+                srcSubs = zarr.internal.region_subs(p.outStart + ip.outStart, ip.inCount);
+                if all(ip.inStart == 0 & ip.inCount == sh.chunkShape)
+                    chunk = reshape(data(srcSubs{:}), innerShape);
+                else
+                    if present(t)
+                        chunk = readOld(t);
+                    else
+                        chunk = fillChunk;
+                    end
+                    dstSubs = zarr.internal.region_subs(ip.inStart, ip.inCount);
+                    chunk(dstSubs{:}) = data(srcSubs{:});
+                end
+                if ~isequaln(chunk, fillChunk)
+                    blobs{k} = sh.innerPipeline.encode(chunk);
+                end
+            end
+        end
+
+        function [blobs, present] = loadShardBlobs(obj, sh, key)
+            %LOADSHARDBLOBS Encoded inner chunks of a stored shard (cell, C
+            %   order, empty where missing; all empty if the shard is absent).
+            total = prod(sh.nChunks);
+            blobs = cell(total, 1);
+            [old, found] = obj.store.get(key);
+            if ~found
+                present = false(total, 1);
+                return
+            end
+            [offsets, lens] = sh.indexEntries(sh.decodeIndex(old));
+            present = offsets ~= intmax('uint64');
+            if any(offsets(present) + lens(present) > numel(old))
+                error("zarr:CodecError", "Shard '%s' is truncated.", key);
+            end
+            for t = reshape(find(present), 1, [])
+                blobs{t} = old(double(offsets(t)) + 1:double(offsets(t) + lens(t)));
+            end
+        end
+
+        function storeShardBlobs(obj, sh, key, blobs)
+            if all(cellfun(@isempty, blobs)) && ~obj.writeEmptyChunks
+                obj.store.erase(key);
+            else
+                obj.streamValue(key, @(w) sh.assembleTo(blobs, w));
+            end
+        end
+
+        function streamValue(obj, key, produce)
+            %STREAMVALUE Write a value through Store.openWrite: produce(w)
+            %   writes its bytes; the value is committed only if it succeeds.
+            %   With skipUnchanged the value is built in memory instead, to
+            %   compare it with the stored one.
+            if obj.skipUnchanged
+                w = zarr.stores.ValueWriter();
+                produce(w);
+                obj.storeChunk(key, w.contents());
+                return
+            end
+            w = obj.store.openWrite(key);
+            try
+                produce(w);
+            catch err
+                w.abort();
+                rethrow(err);
+            end
+            w.commit();
+            obj.countStored(w.position);
+        end
+
+        function data = coerce(obj, data)
+            cls = char(obj.info.matlabClass);
+            if obj.info.zarrType == "bool"
+                data = logical(data);
+            elseif obj.info.zarrType == "string" || obj.info.zarrType == "fixed_length_utf32"
+                data = string(data);
+            elseif obj.info.zarrType == "variable_length_bytes"
+                if ~iscell(data)
+                    error("zarr:TypeMismatch", ...
+                        "variable_length_bytes arrays take cell arrays of uint8 vectors.");
+                end
+            elseif obj.info.zarrType == "structured"
+                if ~isstruct(data)
+                    error("zarr:TypeMismatch", ...
+                        "structured arrays take a struct array with one field per record field.");
+                end
+            elseif ~isa(data, cls)
+                data = cast(data, cls);
+            end
+        end
+
+        function setShapeUncommitted(obj, newShape)
+            %SETSHAPEUNCOMMITTED Set the in-memory shape without writing
+            %   zarr.json (the appender grows it, commits on its cadence and
+            %   restores the committed shape if a store write fails).
+            obj.meta.shape = newShape;
+        end
+
+        function writeMetadataWithShape(obj, shape)
+            m = obj.meta;
+            m.shape = shape;
+            obj.store.set(obj.metaStoreKey(), unicode2native(char(m.toJsonText()), 'UTF-8'));
+        end
+    end
+
+    % ----------------------------------------------------------------------
+    methods (Access = private)
+        function q = asyncQueue(obj)
+            q = [];
+            if ~obj.store.isParallelSafe()
+                return
+            end
+            pool = obj.asyncPool;
+            if isempty(pool)
+                try
+                    pool = backgroundPool;
+                catch
+                    return  % Parallel Computing Toolbox not available
+                end
+            end
+            if isempty(obj.writeQueue)
+                obj.writeQueue = zarr.internal.WriteQueue(pool, obj.asyncMaxBytes);
+            end
+            q = obj.writeQueue;
+            q.pool = pool;
+            q.maxBytes = obj.asyncMaxBytes;
+        end
+
+        function writePart(obj, sh, inPlace, p, data)
+            %WRITEPART Write one chunk (shard) of a region write, holding the
+            %   store's lock on its key across the read-modify-write.
+            key = obj.chunkStoreKey(p.coords);
+            lock = obj.store.lockKey(key); %#ok<NASGU> released on return
+            cs = obj.meta.chunkShape;
+            srcSubs = zarr.internal.region_subs(p.outStart, p.inCount);  % region within data
+            % A part covering every in-bounds element of its chunk (edge
+            % chunks included) replaces the chunk without reading it.
+            inBounds = min(cs, obj.meta.shape - p.coords .* cs);
+            coversChunk = all(p.inStart == 0 & p.inCount == inBounds);
+            if ~coversChunk && ~isempty(sh)
+                if ~(inPlace && obj.updateShardInPlace(sh, key, p, data))
+                    obj.rewriteShard(sh, key, p, data);
+                end
+                return
+            end
+            if coversChunk && all(p.inCount == cs)
+                chunk = reshape(data(srcSubs{:}), zarr.internal.mshape(cs));
+            elseif coversChunk
+                chunk = zarr.internal.fill_array(obj.meta.fillValue, ...
+                    zarr.internal.mshape(cs), obj.info);
+                dstSubs = zarr.internal.region_subs(p.inStart, p.inCount);
+                chunk(dstSubs{:}) = data(srcSubs{:});
+            else
+                [bytes, found] = obj.store.get(key);
+                if found
+                    chunk = obj.pipeline.decode(bytes, obj.codecPool);
+                else
+                    chunk = zarr.internal.fill_array(obj.meta.fillValue, ...
+                        zarr.internal.mshape(cs), obj.info);
+                end
+                dstSubs = zarr.internal.region_subs(p.inStart, p.inCount);
+                chunk(dstSubs{:}) = data(srcSubs{:});
+            end
+            if ~obj.writeEmptyChunks && isequaln(chunk, ...
+                    zarr.internal.fill_array(obj.meta.fillValue, size(chunk), obj.info))
+                obj.store.erase(key);
+            elseif ~isempty(sh)
+                obj.streamValue(key, @(w) sh.encodeTo(chunk, obj.info, w, obj.codecPool));
+            else
+                obj.storeChunk(key, obj.pipeline.encode(chunk, obj.codecPool));
+            end
+        end
+
+        function storeChunk(obj, key, bytes)
+            %STORECHUNK store.set of an encoded chunk, skipped under
+            %   skipUnchanged when the stored value has the same bytes: sizes
+            %   are compared first, then (for large values) a ranged read of
+            %   the head, then the whole value.
+            if obj.skipUnchanged
+                [n, found] = obj.store.sizeOf(key);
+                if found && n == numel(bytes) && obj.storedBytesEqual(key, bytes)
+                    obj.writeStats.skippedBytes = obj.writeStats.skippedBytes + n;
+                    obj.writeStats.chunksSkipped = obj.writeStats.chunksSkipped + 1;
+                    return
+                end
+            end
+            obj.store.set(key, bytes);
+            obj.countStored(numel(bytes));
+        end
+
+        function tf = storedBytesEqual(obj, key, bytes)
+            head = 65536;
+            bytes = reshape(bytes, 1, []);
+            if numel(bytes) > head
+                [part, found] = obj.store.getPartial(key, 0, head);
+                if ~found || ~isequal(reshape(part, 1, []), bytes(1:head))
+                    tf = false;
+                    return
+                end
+            end
+            [old, found] = obj.store.get(key);
+            tf = found && isequal(reshape(old, 1, []), bytes);
+        end
+
+        function countStored(obj, nBytes)
+            obj.writeStats.storedBytes = obj.writeStats.storedBytes + nBytes;
+            obj.writeStats.chunksStored = obj.writeStats.chunksStored + 1;
+        end
+
+        function key = metaStoreKey(obj)
+            if strlength(obj.path) == 0
+                key = "zarr.json";
+            else
+                key = obj.path + "/zarr.json";
+            end
+        end
+
+
         function validateRegion(obj, start, count)
             shape = obj.meta.shape;
             if numel(start) ~= numel(shape) || numel(count) ~= numel(shape)
@@ -432,40 +845,115 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
         function out = readFromShard(obj, sh, key, p, out)
             %READFROMSHARD Partial shard read: fetch the index, then only the
             %   inner chunks that intersect the requested region.
-            if sh.indexLocation == "start"
-                [ib, found] = obj.store.getPartial(key, 0, sh.indexLen);
-            else
-                [ib, found] = obj.store.getSuffix(key, sh.indexLen);
-            end
-            if ~found
+            I = obj.readShardIndex(sh, key);
+            if isempty(I)
                 return  % whole shard missing -> fill (already prefilled)
             end
-            if numel(ib) < sh.indexLen
-                error("zarr:CodecError", "Shard '%s' is smaller than its index.", key);
-            end
-            I = sh.indexPipeline.decode(ib);
             sentinel = intmax('uint64');
 
             innerParts = zarr.internal.chunk_intersections(p.inStart, p.inCount, sh.chunkShape);
+            offs = zeros(1, numel(innerParts));
+            lens = zeros(1, numel(innerParts));
             for k = 1:numel(innerParts)
-                ip = innerParts(k);
-                cSubs = num2cell(ip.coords + 1);
-                off = I(cSubs{:}, 1);
-                len = I(cSubs{:}, 2);
-                if off == sentinel && len == sentinel
-                    continue  % missing inner chunk -> fill
+                cSubs = num2cell(innerParts(k).coords + 1);
+                if I(cSubs{:}, 1) == sentinel && I(cSubs{:}, 2) == sentinel
+                    offs(k) = -1;  % missing inner chunk -> fill
+                else
+                    offs(k) = double(I(cSubs{:}, 1));
+                    lens(k) = double(I(cSubs{:}, 2));
                 end
-                [cb, cbFound] = obj.store.getPartial(key, double(off), double(len));
-                if ~cbFound || numel(cb) < double(len)
+            end
+            innerParts = innerParts(offs >= 0);
+            lens = lens(offs >= 0);
+            offs = offs(offs >= 0);
+            if isempty(offs)
+                return
+            end
+            % One call for all of them: a single multi-range request on HTTP.
+            [blobs, found] = obj.store.getRanges(key, offs, lens);
+            for k = 1:numel(innerParts)
+                ip = innerParts(k);
+                if ~found || numel(blobs{k}) < lens(k)
                     error("zarr:CodecError", "Shard '%s' is truncated.", key);
                 end
-                chunk = sh.innerPipeline.decode(cb);
-                src = subsFor(ip.inStart, ip.inCount);
-                dst = subsFor(p.outStart + ip.outStart, ip.inCount);
+                chunk = sh.innerPipeline.decode(blobs{k});
+                blobs{k} = [];
+                src = zarr.internal.region_subs(ip.inStart, ip.inCount);
+                dst = zarr.internal.region_subs(p.outStart + ip.outStart, ip.inCount);
                 out(dst{:}) = chunk(src{:});
             end
         end
 
+        function handled = updateShardInPlace(obj, sh, key, p, data)
+            %UPDATESHARDINPLACE Append the inner chunks a write touches to an
+            %   existing shard, then rewrite its index (at the end: appended
+            %   after them; at the start: overwritten in place). Returns
+            %   false when the shard should be rewritten whole instead:
+            %   it does not exist yet, or its dead space is past the
+            %   compaction threshold (rewrite-on-compact).
+            handled = false;
+            I = obj.readShardIndex(sh, key);
+            if isempty(I)
+                return
+            end
+            [offsets, lens] = sh.indexEntries(I);
+            sentinel = intmax('uint64');
+            present = offsets ~= sentinel;
+            live = sum(double(lens(present)));
+            shardLen = obj.store.sizeOf(key);
+            if shardLen - live - sh.indexLen > obj.shardCompactionRatio * live
+                return
+            end
+
+            [ts, blobs] = obj.encodeTouchedInnerChunks(sh, p, data, ...
+                @(t) obj.readInnerChunk(sh, key, offsets(t), lens(t)), present);
+            pos = uint64(shardLen);
+            for k = 1:numel(ts)
+                t = ts(k);
+                if isempty(blobs{k})
+                    offsets(t) = sentinel;
+                    lens(t) = sentinel;
+                else
+                    offsets(t) = pos;
+                    lens(t) = uint64(numel(blobs{k}));
+                    pos = pos + lens(t);
+                end
+            end
+
+            if all(offsets == sentinel) && ~obj.writeEmptyChunks
+                obj.store.erase(key);
+                handled = true;
+                return
+            end
+            indexBytes = sh.indexPipeline.encode(sh.buildIndex(offsets, lens));
+            payload = [uint8.empty(1, 0), blobs{:}];
+            if sh.indexLocation == "end"
+                payload = [payload, indexBytes];
+            end
+            if ~isempty(payload) && obj.store.appendBytes(key, payload) ~= shardLen
+                error("zarr:StoreError", ...
+                    "Shard '%s' changed size during an in-place update.", key);
+            end
+            if sh.indexLocation == "start"
+                % Chunks land before the index flips to them, so a reader
+                % sees either the old or the new shard contents.
+                obj.store.writeAt(key, 0, indexBytes);
+            end
+            obj.countStored(numel(payload) + (sh.indexLocation == "start") * numel(indexBytes));
+            handled = true;
+        end
+
+        function rewriteShard(obj, sh, key, p, data)
+            %REWRITESHARD Partial shard write as a whole-shard rewrite that
+            %   re-encodes only the inner chunks the write intersects; all
+            %   other inner chunks are copied from the old shard verbatim.
+            [blobs, present] = obj.loadShardBlobs(sh, key);
+            [ts, touched] = obj.encodeTouchedInnerChunks(sh, p, data, ...
+                @(t) sh.innerPipeline.decode(blobs{t}), present);
+            blobs(ts) = touched;
+            obj.storeShardBlobs(sh, key, blobs);
+        end
+
         function out = readScalar(obj)
             [bytes, found] = obj.store.get(obj.chunkStoreKey([]));
             if found
@@ -476,48 +964,48 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
         end
 
         function writeScalar(obj, data)
-            obj.store.set(obj.chunkStoreKey([]), obj.pipeline.encode(obj.coerce(data)));
+            obj.writeStats.requestedBytes = obj.writeStats.requestedBytes + obj.info.itemsize;
+            obj.storeChunk(obj.chunkStoreKey([]), obj.pipeline.encode(obj.coerce(data)));
         end
 
-        function data = coerce(obj, data)
-            cls = char(obj.info.matlabClass);
-            if obj.info.zarrType == "bool"
-                data = logical(data);
-            elseif obj.info.zarrType == "string" || obj.info.zarrType == "fixed_length_utf32"
-                data = string(data);
-            elseif obj.info.zarrType == "variable_length_bytes"
-                if ~iscell(data)
-                    error("zarr:TypeMismatch", ...
-                        "variable_length_bytes arrays take cell arrays of uint8 vectors.");
-                end
-            elseif obj.info.zarrType == "structured"
-                if ~isstruct(data)
-                    error("zarr:TypeMismatch", ...
-                        "structured arrays take a struct array with one field per record field.");
+        function deleteOutOfBoundsChunks(obj, oldShape)
+            %DELETEOUTOFBOUNDSCHUNKS Erase the chunks of the old grid that
+            %   lie entirely outside the current shape. Their keys follow
+            %   from the two grids; only a shrink that vacates more grid
+            %   slots than maxGridErase (a huge, likely sparse grid) lists
+            %   the store instead.
+            maxGridErase = 1e6;
+            cs = obj.meta.chunkShape;
+            nOld = ceil(oldShape ./ cs);
+            nNew = ceil(obj.meta.shape ./ cs);
+            if prod(nOld) - prod(min(nOld, nNew)) <= maxGridErase
+                coords = outside_grid(nOld, nNew);
+                keys = strings(size(coords, 1), 1);
+                for i = 1:size(coords, 1)
+                    keys(i) = obj.chunkStoreKey(coords(i, :));
                 end
-            elseif ~isa(data, cls)
-                data = cast(data, cls);
+                obj.store.eraseMany(keys);
+                return
             end
-        end
 
-        function deleteOutOfBoundsChunks(obj)
-            shape = obj.meta.shape;
-            cs = obj.meta.chunkShape;
-            maxChunk = max(ceil(shape ./ cs) - 1, 0);  % last valid chunk coord
-            ks = obj.store.list();
+            maxChunk = max(nNew - 1, 0);  % last valid chunk coord
             if strlength(obj.path) > 0
                 pre = obj.path + "/";
-                ks = ks(startsWith(ks, pre));
-                rel = extractAfter(ks, strlength(pre));
             else
-                rel = ks;
+                pre = "";
+            end
+            if obj.meta.keyEncoding == "default"
+                ks = obj.store.listPrefix(pre + "c");   % only the chunk keys
+            else
+                ks = obj.store.listPrefix(pre);
             end
+            rel = extractAfter(ks, strlength(pre));
+            gone = false(numel(rel), 1);
             for i = 1:numel(rel)
                 coords = obj.parseChunkKey(rel(i));
-                if ~isempty(coords) && any(coords > maxChunk)
-                    obj.store.erase(ks(i));
-                end
+                gone(i) = ~isempty(coords) && any(coords > maxChunk);
             end
+            obj.store.eraseMany(ks(gone));
         end
 
         function coords = parseChunkKey(obj, rel)
@@ -541,13 +1029,28 @@ classdef Array < handle & matlab.mixin.indexing.RedefinesParen
     end
 end
 
-function subs = subsFor(start0, count)
-subs = arrayfun(@(s, c) s + 1:s + c, start0, count, 'UniformOutput', false);
-if isscalar(subs)
-    subs{end + 1} = 1;  % rank-1 arrays are column vectors
-end
-end
-
 function tf = iscolon(v)
 tf = (ischar(v) && isequal(v, ':')) || (isstring(v) && v == ":");
 end
+
+function coords = outside_grid(nOld, nNew)
+%OUTSIDE_GRID Coordinates (one row each) of the cells of grid nOld that lie
+%   outside grid nNew: for each dimension d, the slab with coordinate d past
+%   nNew(d) and earlier dimensions inside both grids, so none repeats.
+R = numel(nOld);
+keep = min(nOld, nNew);
+coords = zeros(0, R);
+for d = 1:R
+    lo = zeros(1, R);
+    hi = nOld - 1;
+    lo(d) = nNew(d);
+    hi(1:d - 1) = keep(1:d - 1) - 1;
+    if any(lo > hi)
+        continue
+    end
+    axes = arrayfun(@(a, b) a:b, lo, hi, 'UniformOutput', false);
+    g = cell(1, R);
+    [g{:}] = ndgrid(axes{:});
+    coords = [coords; reshape(cat(R + 1, g{:}), [], R)]; %#ok<AGROW>
+end
+end
@@ -1,4 +1,4 @@
-classdef Group < handle
+classdef Group < zarr.internal.MetadataBatching
     %GROUP A Zarr v3 group.
 
     properties (SetAccess = private)
@@ -101,6 +101,8 @@ classdef Group < handle
                 dtype (1,1) string = "double"
                 opts.ChunkShape = []
                 opts.ShardShape = []
+                opts.AccessPattern (1,1) string = "balanced"
+                opts.TargetChunkBytes (1,1) double = NaN
                 opts.IndexLocation (1,1) string = "end"
                 opts.FillValue = []
                 opts.Codecs = {}
@@ -195,7 +197,13 @@ classdef Group < handle
             end
         end
 
+    end
+
+    methods (Access = protected)
         function writeMetadata(obj)
+            if obj.deferMetadataWrite()
+                return
+            end
             if strlength(obj.path) == 0
                 key = "zarr.json";
             else
@@ -203,5 +211,13 @@ classdef Group < handle
             end
             obj.store.set(key, unicode2native(char(obj.meta.toJsonText()), 'UTF-8'));
         end
+
+        function m = metadataSnapshot(obj)
+            m = obj.meta;
+        end
+
+        function restoreMetadata(obj, m)
+            obj.meta = m;
+        end
     end
 end
@@ -0,0 +1,221 @@
+classdef ShardWriter < handle
+    %SHARDWRITER Buffered write session for a sharded zarr.Array.
+    %   w = z.openWriter(MaxBufferBytes=256*2^20)
+    %   w.write(data, start)       region write into the buffer (1-based start)
+    %   out = w.read(start, count) region read that sees buffered data
+    %   w.flush()                  write every buffered shard now
+    %   w.close()                  flush and end the session (also on delete)
+    %
+    %   Writes are encoded into inner chunks immediately and held per shard.
+    %   Each shard is written to the store once: as soon as every inner chunk
+    %   of it that lies inside the array is buffered, when the buffer exceeds
+    %   MaxBufferBytes (largest shards first), or on flush/close. Inner
+    %   chunks not written during the session keep their stored bytes.
+    %
+    %   The stored shard is read under the store's lock when it is flushed,
+    %   so inner chunks written meanwhile by others (z.write, another
+    %   process) survive unless the writer buffered the same inner chunk;
+    %   a partly covered inner chunk is read back as stored at its first
+    %   write in the session.
+
+    properties (SetAccess = immutable)
+        array
+        maxBufferBytes (1,1) double
+    end
+
+    properties (SetAccess = private)
+        bufferedBytes (1,1) double = 0   % encoded bytes currently held
+        shardsWritten (1,1) double = 0
+    end
+
+    properties (Access = private)
+        sh
+        pending          % containers.Map: shard key -> buffered shard struct
+        isClosed (1,1) logical = false
+    end
+
+    methods
+        function obj = ShardWriter(array, opts)
+            arguments
+                array (1,1) zarr.Array
+                opts.MaxBufferBytes (1,1) double {mustBePositive} = 256 * 2^20
+            end
+            obj.sh = array.shardingCodec();
+            if isempty(obj.sh)
+                error("zarr:UnsupportedFeature", ...
+                    "ShardWriter needs an array whose codec chain is a single sharding_indexed codec.");
+            end
+            obj.array = array;
+            obj.maxBufferBytes = opts.MaxBufferBytes;
+            obj.pending = containers.Map('KeyType', 'char', 'ValueType', 'any');
+        end
+
+        function write(obj, data, start)
+            obj.assertOpen();
+            z = obj.array;
+            R = numel(z.shape);
+            if nargin < 3, start = ones(1, R); end
+            start = reshape(double(start), 1, []);
+            [data, count] = z.normalizeWrite(data, start);
+
+            parts = zarr.internal.chunk_intersections(start - 1, count, z.chunkShape);
+            for i = 1:numel(parts)
+                p = parts(i);
+                key = z.chunkStoreKey(p.coords);
+                e = obj.entry(key, p.coords);
+                present = ~e.has | ~cellfun(@isempty, e.blobs);
+                [ts, blobs] = z.encodeTouchedInnerChunks(obj.sh, p, data, ...
+                    @(t) obj.bufferedOrStored(e, key, t), present);
+                for k = 1:numel(ts)
+                    delta = numel(blobs{k}) - numel(e.blobs{ts(k)});
+                    e.blobs{ts(k)} = blobs{k};
+                    e.has(ts(k)) = true;
+                    e.nBytes = e.nBytes + delta;
+                    obj.bufferedBytes = obj.bufferedBytes + delta;
+                end
+                obj.pending(char(key)) = e;
+                if all(e.has(e.inBounds))
+                    obj.flushShard(key);
+                end
+            end
+
+            while obj.bufferedBytes > obj.maxBufferBytes && obj.pending.Count > 0
+                keys = string(obj.pending.keys());
+                sizes = cellfun(@(e) e.nBytes, obj.pending.values());
+                [~, largest] = max(sizes);
+                obj.flushShard(keys(largest));
+            end
+        end
+
+        function out = read(obj, start, count)
+            obj.assertOpen();
+            z = obj.array;
+            R = numel(z.shape);
+            if nargin < 2, start = ones(1, R); end
+            if nargin < 3, count = z.shape - start + 1; end
+            start = reshape(double(start), 1, []);
+            count = reshape(double(count), 1, []);
+            count(isinf(count)) = z.shape(isinf(count)) - start(isinf(count)) + 1;
+            out = z.read(start, count);
+            if obj.pending.Count == 0
+                return
+            end
+
+            inner = obj.sh.innerPipeline;
+            fillChunk = zarr.internal.fill_array(inner.fillValue, ...
+                zarr.internal.mshape(obj.sh.chunkShape), inner.info);
+            parts = zarr.internal.chunk_intersections(start - 1, count, z.chunkShape);
+            for i = 1:numel(parts)
+                p = parts(i);
+                key = char(z.chunkStoreKey(p.coords));
+                if ~obj.pending.isKey(key)
+                    continue
+                end
+                e = obj.pending(key);
+                innerParts = zarr.internal.chunk_intersections(p.inStart, p.inCount, obj.sh.chunkShape);
+                for k = 1:numel(innerParts)
+                    ip = innerParts(k);
+                    t = zarr.codecs.ShardingCodec.ravelC(ip.coords, obj.sh.nChunks) + 1;
+                    if ~e.has(t)
+                        continue
+                    end
+                    if isempty(e.blobs{t})
+                        chunk = fillChunk;
+                    else
+                        chunk = inner.decode(e.blobs{t});
+                    end
+                    src = zarr.internal.region_subs(ip.inStart, ip.inCount);
+                    dst = zarr.internal.region_subs(p.outStart + ip.outStart, ip.inCount);
+                    out(dst{:}) = chunk(src{:});
+                end
+            end
+        end
+
+        function flush(obj)
+            obj.assertOpen();
+            keys = string(obj.pending.keys());
+            for i = 1:numel(keys)
+                obj.flushShard(keys(i));
+            end
+        end
+
+        function close(obj)
+            if obj.isClosed
+                return
+            end
+            obj.flush();
+            obj.isClosed = true;
+        end
+
+        function delete(obj)
+            if ~isa(obj.pending, 'containers.Map')
+                return  % constructor failed
+            end
+            try % destructor must not throw, but the failure must be visible
+                obj.close();
+            catch err
+                warning("zarr:StoreError", ...
+                    "Failed to flush ShardWriter for '/%s' during destruction: %s", ...
+                    obj.array.path, err.message);
+            end
+        end
+    end
+
+    methods (Access = private)
+        function e = entry(obj, key, coords)
+            %ENTRY Buffered state of one shard, created on first touch.
+            if obj.pending.isKey(char(key))
+                e = obj.pending(char(key));
+                return
+            end
+            z = obj.array;
+            total = prod(obj.sh.nChunks);
+            innerCoords = zarr.codecs.ShardingCodec.unravelC((0:total - 1)', obj.sh.nChunks);
+            origin = coords .* z.chunkShape + innerCoords .* obj.sh.chunkShape;
+            e = struct('blobs', {cell(total, 1)}, 'has', false(total, 1), 'nBytes', 0, ...
+                'inBounds', all(origin < z.shape, 2));
+        end
+
+        function chunk = bufferedOrStored(obj, e, key, t)
+            %BUFFEREDORSTORED Inner chunk t as buffered, else as stored now
+            %   (the index is read at this point, not kept from earlier).
+            inner = obj.sh.innerPipeline;
+            if e.has(t)
+                chunk = inner.decode(e.blobs{t});
+                return
+            end
+            I = obj.array.readShardIndex(obj.sh, key);
+            if ~isempty(I)
+                [offsets, lens] = obj.sh.indexEntries(I);
+                if offsets(t) ~= intmax('uint64')
+                    chunk = obj.array.readInnerChunk(obj.sh, key, offsets(t), lens(t));
+                    return
+                end
+            end
+            chunk = zarr.internal.fill_array(inner.fillValue, ...
+                zarr.internal.mshape(obj.sh.chunkShape), inner.info);
+        end
+
+        function flushShard(obj, key)
+            e = obj.pending(char(key));
+            lock = obj.array.store.lockKey(key); %#ok<NASGU> released on return
+            blobs = e.blobs;
+            if any(~e.has)
+                % re-read under the lock: the shard may have changed since
+                % this session first touched it
+                old = obj.array.loadShardBlobs(obj.sh, key);
+                blobs(~e.has) = old(~e.has);
+            end
+            obj.array.storeShardBlobs(obj.sh, key, blobs);
+            obj.pending.remove(char(key));
+            obj.bufferedBytes = obj.bufferedBytes - e.nBytes;
+            obj.shardsWritten = obj.shardsWritten + 1;
+        end
+
+        function assertOpen(obj)
+            if obj.isClosed
+                error("zarr:StoreError", "ShardWriter for '/%s' is closed.", obj.array.path);
+            end
+        end
+    end
+end
@@ -0,0 +1,137 @@
+function [g, levels] = buildPyramid(z, opts)
+%BUILDPYRAMID Build a multiscale pyramid (OME-Zarr style) next to an array.
+%   [g, levels] = zarr.buildPyramid(z, Levels=3, Method="mean")
+%
+%   Adds Levels arrays beside z in its parent group g, each downsampled 2x
+%   from the previous one along Dims (default: all dimensions; odd edges
+%   keep their last element), with z's chunk grid, codecs and fill value.
+%   Level k+1 is computed from level k in one pass, chunk by chunk: every
+%   output chunk (shard) reads exactly the input region it covers
+%   (zarr.parallelWrite; runs on Pool when given). Method is "mean"
+%   (integer types are rounded), "max" or "nearest" (top-left sample).
+%
+%   Levels are named "1", "2", ... when z is named "0" (the OME-Zarr
+%   layout) and "<name>_1", "<name>_2", ... otherwise. g gets an "ome"
+%   attribute with version 0.5 multiscales metadata (axes from
+%   dimensionNames, one scale transform per level). levels is a cell of
+%   z followed by the new arrays.
+
+arguments
+    z (1,1) zarr.Array
+    opts.Levels (1,1) double {mustBeInteger, mustBePositive} = 3
+    opts.Method (1,1) string {mustBeMember(opts.Method, ["mean", "max", "nearest"])} = "mean"
+    opts.Dims (1,:) double {mustBeInteger, mustBePositive} = 1:numel(z.shape)
+    opts.Pool = []
+    opts.Overwrite (1,1) logical = false
+end
+
+R = numel(z.shape);
+info = zarr.internal.dtype_info(z.meta.dataType, z.meta.dataTypeConfig);
+if R == 0 || any(opts.Dims > R)
+    error("zarr:ShapeMismatch", "Dims must name dimensions of a rank >= 1 array.");
+end
+if ~(ismember(info.matlabClass, ["double", "single", "logical"]) ...
+        || startsWith(info.matlabClass, ["int", "uint"])) || startsWith(info.zarrType, "numpy.")
+    error("zarr:TypeMismatch", "buildPyramid needs a numeric or bool array (got %s).", z.dtype);
+end
+if strlength(z.path) == 0
+    error("zarr:NodeNotFound", "buildPyramid needs an array inside a group, not a root array.");
+end
+parts = split(z.path, "/");
+name = parts(end);
+parentPath = strjoin(parts(1:end - 1), "/");
+g = zarr.open(z.store, Path=parentPath);
+if ~isa(g, "zarr.Group")
+    error("zarr:NodeNotFound", "The parent of '%s' is not a group.", z.path);
+end
+if name == "0"
+    names = string(1:opts.Levels);
+else
+    names = name + "_" + string(1:opts.Levels);
+end
+
+factor = ones(1, R);
+factor(opts.Dims) = 2;
+levels = cell(1, opts.Levels + 1);
+levels{1} = z;
+createArgs = {"ChunkShape", z.chunkShape, "Codecs", z.meta.codecs, ...
+    "FillValue", z.meta.fillValue, "Overwrite", opts.Overwrite};
+if ~isempty(z.dimensionNames)
+    createArgs = [createArgs, {"DimensionNames", z.dimensionNames}];
+end
+for k = 1:opts.Levels
+    prev = levels{k};
+    next = g.createArray(names(k), ceil(prev.shape ./ factor), z.dtype, createArgs{:});
+    if all(next.shape > 0)
+        method = opts.Method;
+        zarr.parallelWrite(next, @(start, count) downsample_block(prev, start, count, ...
+            factor, method), Pool=opts.Pool, SkipFillBlocks=true);
+    end
+    levels{k + 1} = next;
+end
+
+% OME-Zarr 0.5 multiscales: one dataset per level with its scale factor
+axisList = cell(1, R);
+for d = 1:R
+    if ~isempty(z.dimensionNames) && ~ismissing(z.dimensionNames(d))
+        axisList{d} = struct('name', z.dimensionNames(d));
+        type = axis_type(z.dimensionNames(d));
+        if strlength(type) > 0
+            axisList{d}.type = type;
+        end
+    else
+        axisList{d} = struct('name', "dim_" + (d - 1));
+    end
+end
+datasets = cell(1, opts.Levels + 1);
+paths = [name, names];
+for k = 0:opts.Levels
+    datasets{k + 1} = struct('path', paths(k + 1), 'coordinateTransformations', ...
+        {{struct('type', "scale", 'scale', {num2cell(factor .^ k)})}});
+end
+multiscale = struct('name', name, 'axes', {axisList}, 'datasets', {datasets}, ...
+    'type', opts.Method);
+g.setAttr('ome', struct('version', "0.5", 'multiscales', {{multiscale}}));
+end
+
+function out = downsample_block(src, start, count, factor, method)
+% Output block [start, count] of the next level from the input region it
+% covers on src (clipped at the array edge).
+inStart = (start - 1) .* factor + 1;
+inCount = min(count .* factor, src.shape - inStart + 1);
+out = src.read(inStart, inCount);
+cls = class(out);
+for d = find(factor > 1)
+    n = size(out, d);
+    a = take(out, d, 1:2:n);
+    b = take(out, d, min(2:2:n + 1, n));   % odd edge pairs its last element with itself
+    switch method
+        case "mean"
+            out = (double(a) + double(b)) / 2;
+        case "max"
+            out = max(a, b);
+        otherwise
+            out = a;
+    end
+end
+out = cast(out, cls);
+end
+
+function x = take(x, d, idx)
+subs = repmat({':'}, 1, max(ndims(x), d));
+subs{d} = idx;
+x = x(subs{:});
+end
+
+function type = axis_type(name)
+switch lower(name)
+    case {"x", "y", "z"}
+        type = "space";
+    case "t"
+        type = "time";
+    case "c"
+        type = "channel";
+    otherwise
+        type = "";
+end
+end
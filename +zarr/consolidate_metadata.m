@@ -2,6 +2,9 @@ function consolidate_metadata(store)
 %CONSOLIDATE_METADATA Inline all node metadata into the root group's
 %   zarr.json (consolidated_metadata), so hierarchies can be opened with a
 %   single read. Matches zarr-python's v3 consolidated format.
+%
+%   Walks the hierarchy group by group with listDir, so chunk directories
+%   of arrays are never listed.
 
 store = zarr.internal.resolve_store(store);
 
@@ -13,17 +16,29 @@ rootTxt = native2unicode(rootBytes, 'UTF-8');
 rootMeta = zarr.metadata.GroupMetadata.fromJsonText(rootTxt);  % errors on arrays
 
 map = containers.Map('KeyType', 'char', 'ValueType', 'any');
-ks = store.list();
-for i = 1:numel(ks)
-    k = ks(i);
-    if ~endsWith(k, "/zarr.json")
-        continue
-    end
-    path = extractBefore(k, strlength(k) - strlength("/zarr.json") + 1);
-    [bytes, ~] = store.get(k);
-    map(char(path)) = string(native2unicode(bytes, 'UTF-8'));
-end
-
+collect_children(store, "", map);
 rootMeta.consolidated = map;
 store.set("zarr.json", unicode2native(char(rootMeta.toJsonText()), 'UTF-8'));
 end
+
+function collect_children(store, path, map)
+% Record the metadata of every node below the group at path.
+[subdirs, ~] = store.listDir(path);
+for i = 1:numel(subdirs)
+    if strlength(path) > 0
+        child = path + "/" + subdirs(i);
+    else
+        child = subdirs(i);
+    end
+    [bytes, found] = store.get(child + "/zarr.json");
+    if ~found
+        continue   % not a node (v3 has no implicit groups)
+    end
+    txt = string(native2unicode(bytes, 'UTF-8'));
+    map(char(child)) = txt;
+    meta = jsondecode(char(txt));
+    if isfield(meta, 'node_type') && meta.node_type == "group"
+        collect_children(store, child, map);
+    end
+end
+end
@@ -0,0 +1,166 @@
+function node = copy(src, dst, opts)
+%COPY Copy an array or group (with its children) to another store.
+%   node = zarr.copy(src, dst)                 % same path in dst
+%   node = zarr.copy(src, dst, Path="mirror/x", Recursive=true)
+%
+%   src is a zarr.Array or zarr.Group; dst is a directory path or
+%   zarr.stores.Store. By default the stored values — every zarr.json and
+%   the raw chunk/shard bytes — are copied as they are, nothing is decoded.
+%   With Codecs={...} arrays get that codec chain instead (as in
+%   zarr.create) and their chunks are transcoded one aligned block at a
+%   time (zarr.parallelWrite); arrays whose chain already matches are
+%   still copied raw.
+%
+%   Options:
+%     Path       - destination path (default: src.path)
+%     Recursive  - copy the children of a group (default true)
+%     Codecs     - codec chain for the copied arrays (default: unchanged)
+%     Pool       - parallel pool: raw batches (when dst is parallel-safe)
+%                  and transcoded blocks run on its workers
+%     BatchSize  - keys per getMany/setMany batch (default 256)
+%     Overwrite  - replace an existing node at Path (default false)
+%
+%   Values are written before the zarr.json that makes a node visible.
+%   Consolidated metadata is copied raw; after transcoding it is rebuilt
+%   when the copy is the root of dst.
+
+arguments
+    src (1,1) {mustBeA(src, ["zarr.Array", "zarr.Group"])}
+    dst
+    opts.Path (1,1) string = src.path
+    opts.Recursive (1,1) logical = true
+    opts.Codecs cell = {}
+    opts.Pool = []
+    opts.BatchSize (1,1) double {mustBeInteger, mustBePositive} = 256
+    opts.Overwrite (1,1) logical = false
+end
+
+dstStore = zarr.internal.resolve_store(dst);
+path = zarr.internal.normalize_path(opts.Path);
+if dstStore.exists(meta_key(path))
+    if ~opts.Overwrite
+        error("zarr:NodeExists", ...
+            "A node already exists at '%s'. Pass Overwrite=true to replace it.", path);
+    end
+    zarr.delete_node(dstStore, path);
+end
+zarr.internal.ensure_parents(dstStore, path);
+
+pool = opts.Pool;
+if ~isempty(pool) && ~dstStore.isParallelSafe()
+    pool = [];   % worker copies of dst would not share the written keys
+end
+if isempty(opts.Codecs) && (opts.Recursive || isa(src, "zarr.Array"))
+    copy_raw(src.store, subtree_keys(src.store, src.path), src.path, dstStore, path, ...
+        pool, opts.BatchSize);
+else
+    copy_node(src, dstStore, path, opts, pool);
+    if ~isempty(opts.Codecs) && strlength(path) == 0 && isa(src, "zarr.Group") ...
+            && ~isempty(src.meta.consolidated)
+        zarr.consolidate_metadata(dstStore);
+    end
+end
+node = zarr.open(dstStore, Path=path);
+end
+
+function copy_node(src, dstStore, path, opts, pool)
+if isa(src, "zarr.Group")
+    if opts.Recursive
+        [arrayNames, groupNames] = src.children();
+        names = [arrayNames; groupNames];
+        for i = 1:numel(names)
+            copy_node(src.item(names(i)), dstStore, child_path(path, names(i)), opts, pool);
+        end
+    end
+    gm = src.meta;
+    gm.consolidated = [];
+    dstStore.set(meta_key(path), unicode2native(char(gm.toJsonText()), 'UTF-8'));
+    return
+end
+
+meta = src.meta;
+if ~isempty(opts.Codecs)
+    info = zarr.internal.dtype_info(meta.dataType, meta.dataTypeConfig);
+    codecs = zarr.internal.complete_codecs(opts.Codecs, info);
+    meta.codecs = zarr.internal.fill_blosc_typesize(codecs, info.itemsize);
+end
+if strcmp(meta.toJsonText(), src.meta.toJsonText())
+    copy_raw(src.store, subtree_keys(src.store, src.path), src.path, dstStore, path, ...
+        pool, opts.BatchSize);
+    return
+end
+z = zarr.Array(dstStore, path, meta);
+z.writeEmptyChunks = src.writeEmptyChunks;
+if numel(z.shape) == 0
+    z.write(src.read());
+elseif all(z.shape > 0)
+    % destination is empty: blocks that read back as all fill are skipped
+    if isempty(pool)
+        pool = "none";   % serial, even with a parallel pool open
+    end
+    zarr.parallelWrite(z, @(start, count) src.read(start, count), ...
+        Pool=pool, SkipFillBlocks=true);
+end
+dstStore.set(meta_key(path), unicode2native(char(meta.toJsonText()), 'UTF-8'));
+end
+
+function copy_raw(from, keys, fromPath, to, toPath, pool, batchSize)
+% zarr.json values last, deepest first, so each node appears complete.
+isMeta = endsWith(keys, "zarr.json");
+metaKeys = keys(isMeta);
+[~, order] = sort(count(metaKeys, "/"), 'descend');
+if strlength(fromPath) == 0
+    rel = keys;
+else
+    rel = extractAfter(keys, strlength(fromPath) + 1);
+end
+if strlength(toPath) == 0
+    targets = rel;
+else
+    targets = toPath + "/" + rel;
+end
+dataIdx = find(~isMeta);
+edges = 0:batchSize:numel(dataIdx);
+if edges(end) < numel(dataIdx)
+    edges(end + 1) = numel(dataIdx);
+end
+batches = cell(1, numel(edges) - 1);
+for b = 1:numel(batches)
+    idx = dataIdx(edges(b) + 1:edges(b + 1));
+    batches{b} = {keys(idx), targets(idx)};
+end
+zarr.internal.parallel_map(pool, @(batch) copy_batch(from, to, batch{1}, batch{2}), batches);
+metaIdx = find(isMeta);
+metaIdx = metaIdx(order);
+copy_batch(from, to, keys(metaIdx), targets(metaIdx));
+end
+
+function n = copy_batch(from, to, keys, targets)
+[values, found] = from.getMany(keys);
+to.setMany(targets(found), values(found));
+n = nnz(found);
+end
+
+function keys = subtree_keys(store, path)
+if strlength(path) > 0
+    keys = store.listPrefix(path + "/");
+else
+    keys = store.listPrefix("");
+end
+end
+
+function key = meta_key(path)
+if strlength(path) == 0
+    key = "zarr.json";
+else
+    key = path + "/zarr.json";
+end
+end
+
+function p = child_path(path, name)
+if strlength(path) == 0
+    p = name;
+else
+    p = path + "/" + name;
+end
+end
@@ -9,7 +9,10 @@ function z = create(store, shape, dtype, opts)
 %
 %   Options:
 %     Path            - node path within the store (default "" = root)
-%     ChunkShape      - chunk shape (default: whole array in one chunk)
+%     ChunkShape      - chunk shape (default: whole array in one chunk), or
+%                       "auto" for zarr.recommendChunks' chunk shape (and
+%                       shard shape, unless ShardShape is given), using
+%                       AccessPattern and TargetChunkBytes
 %     FillValue       - fill value (default 0 / false)
 %     Codecs          - cell array of codec objects. If it contains no
 %                       array->bytes codec, a little-endian BytesCodec is
@@ -26,8 +29,10 @@ arguments
     shape (1,:) double {mustBeNonnegative, mustBeInteger}
     dtype (1,1) string = "double"
     opts.Path (1,1) string = ""
-    opts.ChunkShape (1,:) double = []
+    opts.ChunkShape = []
     opts.ShardShape (1,:) double = []
+    opts.AccessPattern (1,1) string = "balanced"
+    opts.TargetChunkBytes (1,1) double = NaN
     opts.IndexLocation (1,1) string {mustBeMember(opts.IndexLocation, ["start", "end"])} = "end"
     opts.FillValue = []
     opts.Codecs cell = {}
@@ -54,10 +59,19 @@ dtypeConfig = info.config;
 R = numel(shape);
 
 % Chunk shape
-if isempty(opts.ChunkShape)
+if (isstring(opts.ChunkShape) || ischar(opts.ChunkShape)) && string(opts.ChunkShape) == "auto"
+    rec = zarr.recommendChunks(shape, dtype, AccessPattern=opts.AccessPattern, ...
+        TargetChunkBytes=opts.TargetChunkBytes, Store=store);
+    chunkShape = rec.chunkShape;
+    if isempty(opts.ShardShape)
+        opts.ShardShape = rec.shardShape;
+    end
+elseif isempty(opts.ChunkShape)
     chunkShape = max(shape, 1);
+elseif isnumeric(opts.ChunkShape)
+    chunkShape = reshape(double(opts.ChunkShape), 1, []);
 else
-    chunkShape = reshape(opts.ChunkShape, 1, []);
+    error("zarr:InvalidChunkShape", "ChunkShape must be numeric or ""auto"".");
 end
 if numel(chunkShape) ~= R
     error("zarr:ShapeMismatch", "ChunkShape rank must match shape rank.");
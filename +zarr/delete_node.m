@@ -17,12 +17,9 @@ if ~store.exists(metaKey)
     error("zarr:NodeNotFound", "No node exists at '%s'.", path);
 end
 
-ks = store.list();
-for i = 1:numel(ks)
-    if ks(i) == metaKey || (strlength(prefix) > 0 && startsWith(ks(i), prefix)) ...
-            || (strlength(prefix) == 0 && ks(i) ~= "zarr.json")
-        store.erase(ks(i));
-    end
-end
+% zarr.json last, so an interrupted delete leaves a node that can be
+% deleted again
+ks = store.listPrefix(prefix);
+store.eraseMany(ks(ks ~= metaKey));
 store.erase(metaKey);
 end
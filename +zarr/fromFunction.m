@@ -0,0 +1,28 @@
+function z = fromFunction(store, shape, dtype, producer, varargin)
+%FROMFUNCTION Create an array and fill it block by block from a producer.
+%   z = zarr.fromFunction(store, shape, dtype, @(start, count) ..., Name=Value)
+%
+%   Creates the array with zarr.create (all of its options apply), then
+%   calls producer(start, count) once per chunk- or shard-aligned block and
+%   stores the result, as zarr.parallelWrite does; its Pool, BlockShape and
+%   MaxInFlight options are passed through. Only the blocks in flight are
+%   held in memory, so the array may be far larger than memory. Blocks the
+%   producer returns entirely as the fill value are not stored.
+%
+%   Example (single-process, 1 GiB at a time):
+%     z = zarr.fromFunction("big.zarr", [2^17 2^14], "single", ...
+%         @(start, count) rand(count, "single"), ChunkShape=[2^14 2^14]);
+
+writeNames = ["Pool", "BlockShape", "MaxInFlight"];
+createArgs = {};
+writeArgs = {};
+for i = 1:2:numel(varargin)
+    if any(strcmpi(string(varargin{i}), writeNames))
+        writeArgs = [writeArgs, varargin(i:i + 1)]; %#ok<AGROW>
+    else
+        createArgs = [createArgs, varargin(i:i + 1)]; %#ok<AGROW>
+    end
+end
+z = zarr.create(store, shape, dtype, createArgs{:});
+zarr.parallelWrite(z, producer, writeArgs{:}, SkipFillBlocks=true);
+end
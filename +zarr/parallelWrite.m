@@ -0,0 +1,112 @@
+function n = parallelWrite(z, producer, opts)
+%PARALLELWRITE Fill an array from pool workers, one storage object per task.
+%   n = zarr.parallelWrite(z, producer, Pool=gcp, BlockShape=z.chunkShape)
+%   calls data = producer(start, count) on a worker for every block of z
+%   (1-based start, extent count) and writes the result on that worker, so
+%   data never passes through the client. Blocks are multiples of the
+%   chunk (shard) shape: no two tasks read-modify-write the same chunk or
+%   shard, and edge blocks cover their chunks' in-bounds elements, so every
+%   write takes Array.write's no-read path. Returns the number of blocks.
+%
+%   Pool defaults to the current parallel pool; with none, or with
+%   Pool="none", blocks are written on the client in order (callers with a
+%   pool option of their own pass "none" when theirs is empty, so an open
+%   pool is not picked up behind their back). The store must be parallel-safe
+%   (Store.isParallelSafe, e.g. LocalStore). At most MaxInFlight tasks
+%   (default 0: two per worker) are queued at a time; the first task error is
+%   raised as zarr:StoreError once the tasks in flight have finished.
+%
+%   With SkipFillBlocks=true, blocks the producer returns entirely as the
+%   fill value are not written at all. Use it only where the array holds
+%   no data yet (zarr.fromFunction); otherwise such blocks are written and
+%   their stored chunks erased as usual.
+
+arguments
+    z (1,1) zarr.Array
+    producer (1,1) function_handle
+    opts.Pool = []
+    opts.BlockShape (1,:) double {mustBeInteger, mustBePositive} = z.chunkShape
+    opts.MaxInFlight (1,1) double {mustBeInteger, mustBeNonnegative} = 0
+    opts.SkipFillBlocks (1,1) logical = false
+end
+
+R = numel(z.shape);
+skip = opts.SkipFillBlocks;
+if R == 0
+    write_block(z, producer, [], [], skip);
+    n = 1;
+    return
+end
+if numel(opts.BlockShape) ~= R || any(mod(opts.BlockShape, z.chunkShape) ~= 0)
+    error("zarr:ShapeMismatch", ...
+        "BlockShape [%s] must be a multiple of the chunk shape [%s].", ...
+        join(string(opts.BlockShape), ","), join(string(z.chunkShape), ","));
+end
+[starts, counts] = zarr.internal.aligned_blocks(z.shape, opts.BlockShape);
+n = size(starts, 1);
+
+pool = opts.Pool;
+if (isstring(pool) || ischar(pool)) && string(pool) == "none"
+    pool = [];
+elseif isempty(pool)
+    try
+        pool = gcp('nocreate');
+    catch
+        pool = [];  % Parallel Computing Toolbox not available
+    end
+end
+if isempty(pool)
+    for i = 1:n
+        write_block(z, producer, starts(i, :), counts(i, :), skip);
+    end
+    return
+end
+if ~z.store.isParallelSafe()
+    error("zarr:StoreError", ...
+        "parallelWrite needs a store whose worker copies share data (%s is not).", ...
+        class(z.store));
+end
+
+maxInFlight = opts.MaxInFlight;
+if maxInFlight == 0
+    maxInFlight = 2 * pool.NumWorkers;
+end
+futures = {};
+firstError = [];
+for i = 1:n
+    if numel(futures) >= maxInFlight
+        firstError = finish(futures{1}, firstError);
+        futures(1) = [];
+    end
+    if ~isempty(firstError)
+        break
+    end
+    futures{end + 1} = parfeval(pool, @write_block, 0, ...
+        z, producer, starts(i, :), counts(i, :), skip); %#ok<AGROW>
+end
+for i = 1:numel(futures)
+    firstError = finish(futures{i}, firstError);
+end
+if ~isempty(firstError)
+    err = MException("zarr:StoreError", "parallelWrite failed: %s", firstError.message);
+    throw(err.addCause(firstError));
+end
+end
+
+function firstError = finish(f, firstError)
+wait(f);
+if isempty(firstError) && ~isempty(f.Error)
+    firstError = f.Error;
+end
+end
+
+function write_block(z, producer, start, count, skipFill)
+data = producer(start, count);
+if skipFill
+    info = zarr.internal.dtype_info(z.meta.dataType, z.meta.dataTypeConfig);
+    if isequaln(data, zarr.internal.fill_array(z.meta.fillValue, size(data), info))
+        return
+    end
+end
+z.write(data, start);
+end
@@ -0,0 +1,143 @@
+function [dst, plan] = rechunk(src, store, opts)
+%RECHUNK Copy an array into a new chunk layout within a memory budget.
+%   dst = zarr.rechunk(src, store, ChunkShape=..., MaxMemory=2^30)
+%   [dst, plan] = zarr.rechunk(...)
+%
+%   Creates dst in store (directory path or zarr.stores.Store; any pair of
+%   stores works) with the same dtype, fill value and attributes as src and
+%   the given ChunkShape/ShardShape/Codecs (default: the codecs of src,
+%   resharded for ShardShape), then copies the data in blocks
+%   aligned to both chunk grids, so every source chunk is read once and
+%   every target chunk (shard) is written once:
+%
+%     "direct"    blocks of lcm(source, target) chunks, if such a block fits
+%                 in MaxMemory;
+%     "two-stage" otherwise, via an intermediate array with chunks
+%                 min(source, target) in TempStore (default: a temporary
+%                 LocalStore, deleted afterwards), as in the rechunker
+%                 algorithm;
+%     "blocked"   if neither fits, one target chunk per block (source
+%                 chunks are then read more than once).
+%
+%   Blocks run on Pool when given (zarr.parallelWrite; the destination and
+%   temp stores must then be parallel-safe) with MaxMemory shared between
+%   the workers. plan reports the strategy, blockShape and
+%   intermediateChunkShape.
+
+arguments
+    src (1,1) zarr.Array
+    store
+    opts.Path (1,1) string = ""
+    opts.ChunkShape (1,:) double {mustBeInteger, mustBePositive} = []
+    opts.ShardShape (1,:) double = []
+    opts.Codecs cell = {}
+    opts.MaxMemory (1,1) double {mustBePositive} = 2^30
+    opts.TempStore = []
+    opts.Pool = []
+    opts.Overwrite (1,1) logical = false
+end
+
+if isempty(opts.ChunkShape)
+    error("zarr:ShapeMismatch", "rechunk needs the target ChunkShape.");
+end
+createArgs = {"FillValue", src.meta.fillValue, "Attributes", src.attrs, ...
+    "Path", opts.Path, "Overwrite", opts.Overwrite, ...
+    "ChunkShape", opts.ChunkShape, "ShardShape", opts.ShardShape};
+codecs = opts.Codecs;
+if isempty(codecs)
+    % Keep the source chain; a sharding codec is replaced by its inner
+    % chain, which zarr.create wraps again for the new ShardShape.
+    codecs = src.meta.codecs;
+    k = find(cellfun(@(c) c.name == "sharding_indexed", codecs), 1);
+    if ~isempty(k)
+        createArgs = [createArgs, {"IndexLocation", codecs{k}.indexLocation}];
+        codecs = [codecs(1:k - 1), codecs{k}.codecs, codecs(k + 1:end)];
+    end
+end
+createArgs = [createArgs, {"Codecs", codecs}];
+if ~isempty(src.dimensionNames)
+    createArgs = [createArgs, {"DimensionNames", src.dimensionNames}];
+end
+dtype = src.dtype;
+if startsWith(dtype, "numpy.")   % datetime64 / timedelta64 carry their unit
+    dtype = extractAfter(dtype, "numpy.") + "[" + src.meta.dataTypeConfig.unit + "]";
+end
+dst = zarr.create(store, src.shape, dtype, createArgs{:});
+
+plan = struct('strategy', "direct", 'blockShape', [], 'intermediateChunkShape', []);
+R = numel(src.shape);
+if R == 0 || any(src.shape == 0)
+    plan.blockShape = dst.chunkShape;
+    if R == 0
+        dst.write(src.read());
+    end
+    return
+end
+
+info = zarr.internal.dtype_info(src.meta.dataType, src.meta.dataTypeConfig);
+elem = zarr.internal.fill_array(src.meta.fillValue, [1 1], info); %#ok<NASGU>
+elemBytes = whos('elem').bytes;
+nWorkers = 1;
+if ~isempty(opts.Pool)
+    nWorkers = max(1, opts.Pool.NumWorkers);
+end
+budget = opts.MaxMemory / nWorkers;
+% A block task holds the block plus one decoded source and one target chunk.
+cost = @(block, readChunk, writeChunk) ...
+    (prod(block) + prod(readChunk) + prod(writeChunk)) * elemBytes;
+% Blocks aligned to both grids, no larger than needed to cover the array.
+aligned = @(a, b) min(lcm(a, b), ceil(src.shape ./ b) .* b);
+
+S = src.chunkShape;
+W = dst.chunkShape;
+direct = aligned(S, W);
+I = min(S, W);
+stage1 = aligned(S, I);
+stage2 = aligned(I, W);
+if cost(direct, S, W) <= budget
+    plan.blockShape = direct;
+    copy_blocks(src, dst, direct, opts.Pool);
+elseif cost(stage1, S, I) <= budget && cost(stage2, I, W) <= budget
+    plan.strategy = "two-stage";
+    plan.blockShape = stage2;
+    plan.intermediateChunkShape = I;
+    tempStore = opts.TempStore;
+    tempPath = "rechunk_" + string(java.util.UUID.randomUUID());
+    if isempty(tempStore)
+        tempDir = string(tempname);
+        cleaner = onCleanup(@() rmdir_if(tempDir));
+        tempStore = zarr.stores.LocalStore(tempDir);
+    else
+        cleaner = onCleanup(@() zarr.delete_node(tempStore, tempPath));
+    end
+    mid = zarr.create(tempStore, src.shape, dtype, Path=tempPath, ChunkShape=I, ...
+        FillValue=src.meta.fillValue);
+    copy_blocks(src, mid, stage1, opts.Pool);
+    copy_blocks(mid, dst, stage2, opts.Pool);
+    clear cleaner
+elseif cost(W, S, W) <= budget
+    plan.strategy = "blocked";
+    plan.blockShape = W;
+    copy_blocks(src, dst, W, opts.Pool);
+else
+    error("zarr:MemoryBudget", ...
+        "MaxMemory (%g bytes) is too small for one target chunk of [%s] plus one source chunk.", ...
+        opts.MaxMemory, join(string(W), ","));
+end
+end
+
+function copy_blocks(from, to, blockShape, pool)
+% One block in flight per worker keeps the total within MaxMemory.
+inFlight = 1;
+if isempty(pool)
+    pool = "none";   % serial, even with a parallel pool open
+else
+    inFlight = max(1, pool.NumWorkers);
+end
+zarr.parallelWrite(to, @(start, count) from.read(start, count), ...
+    BlockShape=blockShape, Pool=pool, MaxInFlight=inFlight);
+end
+
+function rmdir_if(p)
+if isfolder(p), rmdir(p, 's'); end
+end
@@ -0,0 +1,141 @@
+function rec = recommendChunks(shape, dtype, opts)
+%RECOMMENDCHUNKS Suggest chunk and shard shapes for an array.
+%   rec = zarr.recommendChunks(shape, dtype)
+%   rec = zarr.recommendChunks(shape, dtype, AccessPattern="time-series", ...
+%       TargetChunkBytes=2^20, Store=store)
+%
+%   Chunks are sized to about TargetChunkBytes: large enough that the
+%   per-request cost (a file open, an HTTP round trip) is small next to the
+%   transfer, small enough that a read touching one element does not
+%   decode much more than it needs. The default target is 1 MiB, 4 MiB on
+%   an HttpStore (higher per-request latency). AccessPattern decides which
+%   dimensions the chunk extends along:
+%
+%     "balanced"     all dimensions equally (near-cubic chunks)
+%     "time-series"  dimension 1 first (whole series per chunk), then the rest
+%     "image-slices" the last two dimensions first (whole planes), then the rest
+%     "random"       near-cubic with a quarter of the target, to limit the
+%                    bytes decoded per scattered read
+%
+%   When that leaves more than MaxChunks chunks, chunks are grouped into
+%   shards of about TargetShardBytes (default 64 MiB), along the same
+%   dimensions, so the store holds fewer, larger objects while reads still
+%   fetch single chunks.
+%
+%   rec has fields chunkShape, shardShape ([] when unsharded), chunkBytes,
+%   shardBytes, nChunks, nShards (stored objects) and reasoning (one line
+%   per decision). zarr.create(..., ChunkShape="auto") applies it.
+
+arguments
+    shape (1,:) double {mustBeNonnegative, mustBeInteger}
+    dtype (1,1) string = "double"
+    opts.AccessPattern (1,1) string {mustBeMember(opts.AccessPattern, ...
+        ["balanced", "time-series", "image-slices", "random"])} = "balanced"
+    opts.TargetChunkBytes (1,1) double = NaN
+    opts.TargetShardBytes (1,1) double {mustBePositive} = 64 * 2^20
+    opts.MaxChunks (1,1) double {mustBePositive} = 10000
+    opts.Store = []
+end
+
+R = numel(shape);
+tok = regexp(char(dtype), '^(?:numpy\.)?(datetime64|timedelta64)\[(\w+)\]$', 'tokens', 'once');
+if ~isempty(tok)
+    itemsize = 8;
+else
+    info = zarr.internal.dtype_info(zarr.internal.normalize_dtype(dtype), []);
+    itemsize = info.itemsize;
+end
+reasoning = strings(0, 1);
+if ~(itemsize > 0)
+    itemsize = 16;   % variable-length types: assume short values
+    reasoning(end + 1) = "Variable-length dtype: sizing for 16 bytes per element.";
+end
+
+target = opts.TargetChunkBytes;
+if isnan(target)
+    if isa(opts.Store, "zarr.stores.HttpStore")
+        target = 4 * 2^20;
+        reasoning(end + 1) = "HTTP store: 4 MiB target chunk to amortize request latency.";
+    else
+        target = 2^20;
+        reasoning(end + 1) = "Target chunk size 1 MiB.";
+    end
+end
+if opts.AccessPattern == "random"
+    target = target / 4;
+    reasoning(end + 1) = sprintf("Random access: target lowered to %s to limit read amplification.", ...
+        fmt_bytes(target));
+end
+
+rec = struct('chunkShape', zeros(1, 0), 'shardShape', [], 'chunkBytes', itemsize, ...
+    'shardBytes', 0, 'nChunks', 1, 'nShards', 1, 'reasoning', reasoning);
+if R == 0
+    rec.reasoning(end + 1) = "Rank-0 array: a single chunk.";
+    return
+end
+
+extent = max(shape, 1);
+budget = max(1, floor(target / itemsize));
+switch opts.AccessPattern
+    case "time-series"
+        order = {1, 2:R};
+        why = "Time series: chunks span dimension 1 first.";
+    case "image-slices"
+        planes = max(1, R - 1):R;
+        order = {planes, setdiff(1:R, planes)};
+        why = "Image slices: chunks span the last two dimensions first.";
+    otherwise
+        order = {1:R};
+        why = "Chunks span all dimensions evenly.";
+end
+chunk = fill_dims(ones(1, R), extent, budget, order);
+rec.chunkShape = chunk;
+rec.chunkBytes = prod(chunk) * itemsize;
+grid = ceil(extent ./ chunk);
+rec.nChunks = prod(grid);
+rec.nShards = rec.nChunks;
+rec.reasoning(end + 1) = why + sprintf(" Chunk [%s] = %s, %d chunks.", ...
+    join(string(chunk), " "), fmt_bytes(rec.chunkBytes), rec.nChunks);
+
+if rec.nChunks > opts.MaxChunks
+    perShard = max(1, floor(opts.TargetShardBytes / rec.chunkBytes));
+    multiples = fill_dims(ones(1, R), grid, perShard, order);
+    if prod(multiples) > 1
+        rec.shardShape = multiples .* chunk;
+        rec.shardBytes = prod(rec.shardShape) * itemsize;
+        rec.nShards = prod(ceil(grid ./ multiples));
+        rec.reasoning(end + 1) = sprintf( ...
+            "%d chunks exceed %d objects: shards of [%s] chunks (%s), %d shards.", ...
+            rec.nChunks, opts.MaxChunks, join(string(multiples), " "), ...
+            fmt_bytes(rec.shardBytes), rec.nShards);
+    end
+else
+    rec.reasoning(end + 1) = "Few enough chunks that sharding would not help.";
+end
+end
+
+function c = fill_dims(c, extent, budget, order)
+% Grow c within extent, group by group, until prod(c) reaches budget;
+% inside a group the remaining budget is shared evenly, small extents first.
+for g = 1:numel(order)
+    dims = order{g};
+    [~, idx] = sort(extent(dims));
+    dims = dims(idx);
+    for k = 1:numel(dims)
+        d = dims(k);
+        share = budget ^ (1 / (numel(dims) - k + 1));
+        c(d) = max(1, min(extent(d), floor(share * (1 + 1e-9))));
+        budget = max(1, budget / c(d));
+    end
+end
+end
+
+function s = fmt_bytes(n)
+if n >= 2^20
+    s = sprintf("%.3g MiB", n / 2^20);
+elseif n >= 2^10
+    s = sprintf("%.3g KiB", n / 2^10);
+else
+    s = sprintf("%d B", n);
+end
+end
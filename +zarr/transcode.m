@@ -0,0 +1,230 @@
+function report = transcode(z, opts)
+%TRANSCODE Re-encode an array's chunks with a new codec chain, in place.
+%   report = zarr.transcode(z, Codecs={zarr.codecs.ZstdCodec(9)})
+%
+%   Codecs is a codec chain as in zarr.create (a ShardingCodec keeps the
+%   stored chunk grid). Each stored chunk (shard) is read with the current
+%   chain and written with the new one under the staging node
+%   "<path>/.transcode", which readers of the array never look at. Once
+%   every chunk is staged, a single zarr.json write switches the array to
+%   the new chain and marks the move; arrays opened from it read each
+%   chunk from the staging node until it has been moved over the array's
+%   own key (same key encoding and separator). The staged values are then
+%   moved in waves of at most MoveBytes (default 256 MiB), zarr.json is
+%   written once more without the mark, and the staging node is removed.
+%   z is refreshed afterwards. Readers other than zarr-matlab do not know
+%   the mark and should not open the array until transcode returns.
+%
+%   Chunk keys do not change, so a handle opened before the transcode
+%   never reads fill values for data that exists: it fails to decode the
+%   re-encoded chunks until refresh() is called.
+%
+%   Chunks run on Pool (default: the current parallel pool, if any; the
+%   store must be parallel-safe) with at most MaxInFlight (default 0: two
+%   per worker) decoded chunks in memory at a time. Progress is recorded
+%   after every group of MaxInFlight chunks in ".transcode.json" next to
+%   zarr.json; calling transcode again with the same Codecs after an
+%   interruption resumes from there (other Codecs start over).
+%
+%   report has fields chunks, resumedAt (chunks already done on entry),
+%   bytesBefore, bytesAfter (stored chunk bytes), seconds and
+%   throughputMBps (uncompressed MB transcoded per second in this call).
+
+arguments
+    z (1,1) zarr.Array
+    opts.Codecs cell = {}
+    opts.Pool = []
+    opts.MaxInFlight (1,1) double {mustBeInteger, mustBeNonnegative} = 0
+    opts.MoveBytes (1,1) double {mustBePositive} = 256 * 2^20
+end
+
+z.wait();
+t0 = tic;
+store = z.store;
+if isa(store, "zarr.internal.StagedChunkStore")
+    store = store.inner;   % z was opened during an interrupted move
+end
+attr = zarr.internal.StagedChunkStore.Attribute;
+old = z.meta;
+if isfield(old.attributes, attr)
+    old.attributes = rmfield(old.attributes, attr);
+end
+info = zarr.internal.dtype_info(old.dataType, old.dataTypeConfig);
+new = old;
+new.codecs = zarr.internal.fill_blosc_typesize( ...
+    zarr.internal.complete_codecs(opts.Codecs, info), info.itemsize);
+newJson = unicode2native(char(new.toJsonText()), 'UTF-8');
+moveMeta = new;
+moveMeta.attributes.(attr) = ".transcode";
+moveJson = unicode2native(char(moveMeta.toJsonText()), 'UTF-8');
+if strlength(z.path) == 0
+    prefix = "";
+else
+    prefix = z.path + "/";
+end
+metaKey = prefix + "zarr.json";
+progressKey = prefix + ".transcode.json";
+stagePath = prefix + ".transcode";
+stagePrefix = stagePath + "/";
+R = numel(old.shape);
+report = struct('chunks', 0, 'resumedAt', 0, 'bytesBefore', 0, 'bytesAfter', 0, ...
+    'seconds', 0, 'throughputMBps', 0);
+
+report.bytesBefore = stored_bytes(store, chunk_keys(store, prefix, old));
+
+done = 0;
+moving = false;
+[bytes, found] = store.get(progressKey);
+if found
+    progress = jsondecode(native2unicode(bytes, 'UTF-8'));
+    if strcmp(progress.metadata, native2unicode(newJson, 'UTF-8'))
+        done = progress.chunksDone;
+        moving = isfield(progress, 'phase') && progress.phase == "move";
+    elseif isfield(progress, 'phase') && progress.phase == "move"
+        % some chunks under the array's keys already hold the other chain
+        error("zarr:StoreError", ...
+            "An interrupted transcode of '%s' is being moved in; call transcode again with the same Codecs to finish it.", ...
+            z.path);
+    else
+        store.eraseMany(store.listPrefix(stagePrefix));
+    end
+end
+report.resumedAt = done;
+
+dst = zarr.Array(store, stagePath, new);
+dst.writeEmptyChunks = z.writeEmptyChunks;
+if R == 0
+    starts = zeros(1, 0);  % one chunk, "c"
+    counts = zeros(1, 0);
+else
+    [starts, counts] = zarr.internal.aligned_blocks(old.shape, old.chunkShape);
+end
+n = size(starts, 1);
+report.chunks = n;
+
+pool = opts.Pool;
+if isempty(pool)
+    try
+        pool = gcp('nocreate');
+    catch
+        pool = [];  % Parallel Computing Toolbox not available
+    end
+end
+if ~isempty(pool) && ~store.isParallelSafe()
+    error("zarr:StoreError", ...
+        "transcode on a pool needs a store whose worker copies share data (%s is not).", ...
+        class(store));
+end
+wave = opts.MaxInFlight;
+if wave == 0
+    if isempty(pool)
+        wave = 64;
+    else
+        wave = 2 * pool.NumWorkers;
+    end
+end
+
+processed = 0;
+while done < n && ~moving
+    idx = done + 1:min(n, done + wave);
+    if isempty(pool)
+        for i = idx
+            transcode_chunk(z, dst, starts(i, :), counts(i, :));
+        end
+    else
+        futures = cell(1, numel(idx));
+        for k = 1:numel(idx)
+            futures{k} = parfeval(pool, @transcode_chunk, 0, ...
+                z, dst, starts(idx(k), :), counts(idx(k), :));
+        end
+        firstError = [];
+        for k = 1:numel(futures)
+            wait(futures{k});
+            if isempty(firstError) && ~isempty(futures{k}.Error)
+                firstError = futures{k}.Error;
+            end
+        end
+        if ~isempty(firstError)
+            err = MException("zarr:StoreError", ...
+                "transcode stopped after %d of %d chunks (call it again to resume): %s", ...
+                done, n, firstError.message);
+            throw(err.addCause(firstError));
+        end
+    end
+    processed = processed + sum(prod(counts(idx, :), 2));
+    done = idx(end);
+    store.set(progressKey, unicode2native(jsonencode(struct( ...
+        'metadata', native2unicode(newJson, 'UTF-8'), 'chunksDone', done)), 'UTF-8'));
+end
+
+staged = chunk_keys(store, stagePrefix, new);
+targets = prefix + extractAfter(staged, strlength(stagePrefix));
+if ~moving
+    % Chunks the new chain left unstored hold only the fill value; erasing
+    % them first keeps the move itself resumable from the staged keys.
+    oldKeys = chunk_keys(store, prefix, old);
+    store.eraseMany(oldKeys(~ismember(oldKeys, targets)));
+    store.set(progressKey, unicode2native(jsonencode(struct( ...
+        'metadata', native2unicode(newJson, 'UTF-8'), 'chunksDone', n, ...
+        'phase', "move")), 'UTF-8'));
+end
+% The switch: one zarr.json write naming the new chain and the staging
+% node. From here readers (through zarr.internal.StagedChunkStore) take a
+% chunk from staging until it is moved, so the array always decodes.
+store.set(metaKey, moveJson);
+sizes = zeros(numel(staged), 1);
+for i = 1:numel(staged)
+    sizes(i) = store.sizeOf(staged(i));
+end
+first = 1;
+while first <= numel(staged)
+    % waves of at most MoveBytes (and at least one value)
+    k = find(cumsum(sizes(first:end)) <= opts.MoveBytes, 1, 'last');
+    if isempty(k)
+        k = 1;
+    end
+    last = first + k - 1;
+    idx = first:last;
+    [values, got] = store.getMany(staged(idx));
+    store.setMany(targets(idx(got)), values(got));
+    store.eraseMany(staged(idx));
+    first = last + 1;
+end
+
+store.set(metaKey, newJson);
+store.eraseMany(store.listPrefix(stagePrefix));
+store.erase(progressKey);
+z.refresh();
+report.bytesAfter = stored_bytes(store, chunk_keys(store, prefix, new));
+report = finish_report(report, t0, processed * info.itemsize);
+end
+
+function transcode_chunk(src, dst, start, count)
+dst.write(src.read(start, count), start);
+end
+
+function keys = chunk_keys(store, prefix, meta)
+% Stored chunk keys of the node at prefix under meta's key encoding.
+sep = regexptranslate('escape', char(meta.keySeparator));
+if meta.keyEncoding == "default"
+    pattern = "^c(" + sep + "\d+)*$";
+    keys = store.listPrefix(prefix + "c");
+else
+    pattern = "^\d+(" + sep + "\d+)*$";
+    keys = store.listPrefix(prefix);
+end
+rel = extractAfter(keys, strlength(prefix));
+keys = reshape(keys(~cellfun(@isempty, regexp(rel, pattern, 'once'))), [], 1);
+end
+
+function n = stored_bytes(store, keys)
+n = 0;
+for i = 1:numel(keys)
+    n = n + store.sizeOf(keys(i));
+end
+end
+
+function report = finish_report(report, t0, nBytes)
+report.seconds = toc(t0);
+report.throughputMBps = nBytes / 1e6 / max(report.seconds, eps);
+end
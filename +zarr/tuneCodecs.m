@@ -0,0 +1,170 @@
+function [codecs, results] = tuneCodecs(sampleData, opts)
+%TUNECODECS Benchmark candidate codec chains on sample data and pick one.
+%   [codecs, results] = zarr.tuneCodecs(sampleData, Objective="balanced")
+%   z = zarr.create(store, shape, class(sampleData), Codecs=codecs, ...)
+%
+%   sampleData is a numeric or logical array representative of what will
+%   be stored. With ChunkShape, up to MaxChunks chunks spread over the
+%   sample are measured separately (the way they will be stored);
+%   otherwise the whole sample is one chunk. Each candidate chain encodes
+%   and decodes every chunk Repeats times (best time counts):
+%
+%     raw bytes; zstd levels 1/3/9/19; shuffle + zstd-3; blosc with lz4 or
+%     zstd x noshuffle/shuffle/bitshuffle x automatic or 256 KiB blocks
+%     (typesize from the dtype); gzip 1/6, which needs no MEX.
+%
+%   Chains whose MEX is not built are left out. results is a table with
+%   one row per chain — name, encodeMBps, decodeMBps (uncompressed MB/s),
+%   ratio (uncompressed / stored), pareto (not beaten on all three by
+%   another chain) and score — sorted by score for the Objective:
+%   "read" (decode speed), "write" (encode speed), "size" (ratio) or
+%   "balanced" (geometric mean of the three, each relative to the best).
+%   codecs is the top row's chain, ready for zarr.create.
+
+arguments
+    sampleData {mustBeNumericOrLogical}
+    opts.Objective (1,1) string {mustBeMember(opts.Objective, ["read", "write", "size", "balanced"])} = "balanced"
+    opts.ChunkShape (1,:) double {mustBeInteger, mustBePositive} = []
+    opts.MaxChunks (1,1) double {mustBeInteger, mustBePositive} = 4
+    opts.Repeats (1,1) double {mustBeInteger, mustBePositive} = 3
+end
+
+if isempty(sampleData)
+    error("zarr:ShapeMismatch", "tuneCodecs needs a non-empty sample.");
+end
+if isreal(sampleData)
+    cls = class(sampleData);
+elseif isa(sampleData, "single")
+    cls = "complex64";
+else
+    cls = "complex128";
+end
+info = zarr.internal.dtype_info(zarr.internal.normalize_dtype(cls), []);
+if isvector(sampleData) && size(sampleData, 2) == 1
+    shape = numel(sampleData);   % column vector: a rank-1 array
+else
+    shape = size(sampleData);
+end
+chunks = sample_chunks(sampleData, shape, opts.ChunkShape, opts.MaxChunks);
+nBytes = sum(cellfun(@(c) numel(c), chunks)) * info.itemsize;
+
+[names, chains] = candidates(info);
+n = numel(chains);
+encodeMBps = zeros(n, 1);
+decodeMBps = zeros(n, 1);
+ratio = zeros(n, 1);
+ok = true(n, 1);
+for i = 1:n
+    tEnc = 0;
+    tDec = 0;
+    stored = 0;
+    for k = 1:numel(chunks)
+        A = chunks{k};
+        p = zarr.codecs.Pipeline(chains{i}, info, chunk_shape(A, numel(shape)));
+        best = [Inf Inf];
+        for r = 1:opts.Repeats
+            t = tic;
+            bytes = p.encode(A);
+            best(1) = min(best(1), toc(t));
+            t = tic;
+            back = p.decode(bytes);
+            best(2) = min(best(2), toc(t));
+        end
+        if ~isequaln(back, A)
+            ok(i) = false;   % lossy or broken chain: never recommend it
+        end
+        tEnc = tEnc + best(1);
+        tDec = tDec + best(2);
+        stored = stored + numel(bytes);
+    end
+    encodeMBps(i) = nBytes / 1e6 / max(tEnc, eps);
+    decodeMBps(i) = nBytes / 1e6 / max(tDec, eps);
+    ratio(i) = nBytes / max(stored, 1);
+end
+
+names = names(ok);
+chains = chains(ok);
+results = table(names, encodeMBps(ok), decodeMBps(ok), ratio(ok), ...
+    'VariableNames', {'name', 'encodeMBps', 'decodeMBps', 'ratio'});
+m = [results.encodeMBps, results.decodeMBps, results.ratio];
+results.pareto = arrayfun(@(r) ~any(all(m >= m(r, :), 2) & any(m > m(r, :), 2)), ...
+    (1:height(results))');
+rel = m ./ max(m, [], 1);
+switch opts.Objective
+    case "read"
+        results.score = rel(:, 2);
+    case "write"
+        results.score = rel(:, 1);
+    case "size"
+        results.score = rel(:, 3);
+    otherwise
+        results.score = prod(rel, 2) .^ (1 / 3);
+end
+[~, order] = sortrows([results.score, results.ratio], [-1 -2]);
+results = results(order, :);
+chains = chains(order);
+codecs = chains{1};
+end
+
+function [names, chains] = candidates(info)
+itemsize = info.itemsize;
+complete = @(c) zarr.internal.complete_codecs(c, info);
+names = "bytes";
+chains = {complete({})};
+if ~isempty(which('zarr.internal.zstd_mex'))
+    for level = [1 3 9 19]
+        names(end + 1, 1) = "zstd-" + level; %#ok<AGROW>
+        chains{end + 1, 1} = complete({zarr.codecs.ZstdCodec(level)}); %#ok<AGROW>
+    end
+    if itemsize > 1
+        names(end + 1, 1) = "shuffle+zstd-3";
+        chains{end + 1, 1} = complete({zarr.codecs.ShuffleCodec(itemsize), ...
+            zarr.codecs.ZstdCodec(3)});
+    end
+end
+if ~isempty(which('zarr.internal.blosc_mex'))
+    for cname = ["lz4", "zstd"]
+        for shuffle = ["noshuffle", "shuffle", "bitshuffle"]
+            for blocksize = [0, 2^18]
+                names(end + 1, 1) = sprintf("blosc-%s-%s%s", cname, shuffle, ...
+                    string(repmat('-256k', 1, blocksize > 0))); %#ok<AGROW>
+                chains{end + 1, 1} = complete({zarr.codecs.BloscCodec(cname=cname, ...
+                    clevel=5, shuffle=shuffle, typesize=itemsize, blocksize=blocksize)}); %#ok<AGROW>
+            end
+        end
+    end
+end
+for level = [1 6]
+    names(end + 1, 1) = "gzip-" + level; %#ok<AGROW>
+    chains{end + 1, 1} = complete({zarr.codecs.GzipCodec(level)}); %#ok<AGROW>
+end
+end
+
+function chunks = sample_chunks(data, shape, chunkShape, maxChunks)
+if isempty(chunkShape)
+    chunks = {data};
+    return
+end
+if numel(chunkShape) ~= numel(shape)
+    error("zarr:ShapeMismatch", "ChunkShape rank must match the sample's rank.");
+end
+[starts, counts] = zarr.internal.aligned_blocks(shape, chunkShape);
+pick = unique(round(linspace(1, size(starts, 1), min(maxChunks, size(starts, 1)))));
+chunks = cell(1, numel(pick));
+for k = 1:numel(pick)
+    subs = cell(1, max(2, numel(shape)));
+    subs(:) = {1};
+    for d = 1:numel(shape)
+        subs{d} = starts(pick(k), d) - 1 + (1:counts(pick(k), d));
+    end
+    chunks{k} = data(subs{:});
+end
+end
+
+function s = chunk_shape(A, R)
+if R == 1
+    s = numel(A);
+else
+    s = size(A, 1:R);
+end
+end
@@ -0,0 +1,475 @@
+/* localfs_mex.c - file primitives for zarr.stores.LocalStore.
+ *
+ *   localfs_mex('rename', from, to)   atomic replace of to by from
+ *   localfs_mex('fsync', path)        flush a file (or, on POSIX, a
+ *                                     directory) to stable storage
+ *   [data, found] = localfs_mex('pread', path, offset, len)
+ *                                     len bytes at offset (len < 0: to EOF)
+ *   [data, found] = localfs_mex('tail', path, len)
+ *                                     the last len bytes
+ *   localfs_mex('forget', path)       drop the cached handle of path
+ *   localfs_mex('closeall')           drop every cached handle
+ *   bytes = localfs_mex('list', dir)  every file below dir, as UTF-8
+ *                                     relative paths ('/'-separated), one
+ *                                     per line
+ *
+ * MATLAB's movefile spawns a lot of machinery per call and has no fsync at
+ * all; these are single system calls. Reads on POSIX go through a small LRU
+ * cache of read-only descriptors and pread, so a shard read (index plus
+ * several inner chunks) opens its file once. Each read stats the path and
+ * reopens when it names a different file than the cached descriptor (it
+ * was replaced by a rename), so writers in other processes are seen.
+ * A missing file gives found = false, not an error. 'list' walks with
+ * readdir (FindFirstFileEx on Windows) in one call, where MATLAB's
+ * dir('**') builds a struct per entry. Self-contained.
+ */
+#include <string.h>
+#include "mex.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define PATH_MAX_LEN 32768
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} buffer;
+
+static void append(buffer *b, const char *s, size_t n)
+{
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 65536;
+        while (cap < b->len + n)
+            cap *= 2;
+        char *grown = (char *)mxRealloc(b->data, cap);
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static int skip_name(const char *name, size_t n)
+{
+    return (n == 1 && name[0] == '.') || (n == 2 && name[0] == '.' && name[1] == '.');
+}
+
+static void get_path(const mxArray *a, char *buf, const char *what)
+{
+    if (!mxIsChar(a) || mxGetString(a, buf, PATH_MAX_LEN) != 0)
+        mexErrMsgIdAndTxt("zarr:InternalError", "localfs_mex: %s must be a char path", what);
+}
+
+#ifdef _WIN32
+static wchar_t *widen(const char *s)
+{
+    int n = MultiByteToWideChar(CP_UTF8, 0, s, -1, NULL, 0);
+    wchar_t *w = (wchar_t *)mxMalloc((size_t)n * sizeof(wchar_t));
+    MultiByteToWideChar(CP_UTF8, 0, s, -1, w, n);
+    return w;
+}
+
+static void do_rename(const char *from, const char *to)
+{
+    wchar_t *wf = widen(from), *wt = widen(to);
+    BOOL ok = MoveFileExW(wf, wt, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    DWORD err = GetLastError();
+    mxFree(wf);
+    mxFree(wt);
+    if (!ok)
+        mexErrMsgIdAndTxt("zarr:StoreError", "rename '%s' -> '%s' failed (error %lu)",
+                          from, to, (unsigned long)err);
+}
+
+static void do_fsync(const char *path)
+{
+    wchar_t *wp = widen(path);
+    DWORD attrs = GetFileAttributesW(wp);
+    if (attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY)) {
+        mxFree(wp);
+        return;  /* NTFS metadata is journaled; directories cannot be flushed */
+    }
+    HANDLE h = CreateFileW(wp, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    mxFree(wp);
+    if (h == INVALID_HANDLE_VALUE)
+        mexErrMsgIdAndTxt("zarr:StoreError", "fsync: cannot open '%s'", path);
+    BOOL ok = FlushFileBuffers(h);
+    CloseHandle(h);
+    if (!ok)
+        mexErrMsgIdAndTxt("zarr:StoreError", "fsync '%s' failed", path);
+}
+
+/* Windows keeps no handle cache: an open handle would block the rename that
+ * replaces the file. Returns NULL when the file does not exist. */
+static mxArray *do_read(const char *path, double offset, double len, int fromEnd)
+{
+    wchar_t *wp = widen(path);
+    HANDLE h = CreateFileW(wp, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    mxFree(wp);
+    if (h == INVALID_HANDLE_VALUE) {
+        DWORD err = GetLastError();
+        if (err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND)
+            return NULL;
+        mexErrMsgIdAndTxt("zarr:StoreError", "cannot open '%s' (error %lu)", path, (unsigned long)err);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(h, &size);
+    double n = (double)size.QuadPart;
+    if (fromEnd) {
+        offset = len >= 0 && len < n ? n - len : 0;
+        len = n - offset;
+    } else if (len < 0 || offset + len > n) {
+        len = offset < n ? n - offset : 0;
+    }
+    mxArray *out = mxCreateNumericMatrix(1, (mwSize)len, mxUINT8_CLASS, mxREAL);
+    unsigned char *buf = (unsigned char *)mxGetData(out);
+    size_t got = 0, want = (size_t)len;
+    while (got < want) {
+        OVERLAPPED ov;
+        DWORD chunk = want - got > 0x40000000 ? 0x40000000 : (DWORD)(want - got), r = 0;
+        unsigned long long at = (unsigned long long)offset + got;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)at;
+        ov.OffsetHigh = (DWORD)(at >> 32);
+        if (!ReadFile(h, buf + got, chunk, &r, &ov) || r == 0)
+            break;
+        got += r;
+    }
+    CloseHandle(h);
+    mxSetN(out, (mwSize)got);
+    return out;
+}
+
+static void forget(const char *path) { (void)path; }
+static void close_all(void) {}
+
+/* dir holds the absolute directory (wide), rel the key prefix (UTF-8) */
+static void walk(wchar_t *dir, size_t dlen, char *rel, size_t rlen, buffer *out)
+{
+    WIN32_FIND_DATAW fd;
+    if (dlen + 3 >= PATH_MAX_LEN)
+        return;
+    wcscpy(dir + dlen, L"\\*");
+    HANDLE h = FindFirstFileExW(dir, FindExInfoBasic, &fd, FindExSearchNameMatch, NULL,
+                                FIND_FIRST_EX_LARGE_FETCH);
+    dir[dlen] = 0;
+    if (h == INVALID_HANDLE_VALUE)
+        return;
+    do {
+        char name[3 * MAX_PATH + 1];
+        int n = WideCharToMultiByte(CP_UTF8, 0, fd.cFileName, -1, name, sizeof(name), NULL, NULL) - 1;
+        if (n <= 0 || skip_name(name, (size_t)n))
+            continue;
+        size_t wn = wcslen(fd.cFileName);
+        if (dlen + 1 + wn >= PATH_MAX_LEN || rlen + (size_t)n + 1 >= PATH_MAX_LEN)
+            continue;
+        memcpy(rel + rlen, name, (size_t)n);
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+                continue;  /* junctions can form cycles */
+            dir[dlen] = L'\\';
+            wcscpy(dir + dlen + 1, fd.cFileName);
+            rel[rlen + n] = '/';
+            walk(dir, dlen + 1 + wn, rel, rlen + (size_t)n + 1, out);
+            dir[dlen] = 0;
+        } else {
+            rel[rlen + n] = '\n';
+            append(out, rel, rlen + (size_t)n + 1);
+        }
+    } while (FindNextFileW(h, &fd));
+    FindClose(h);
+}
+
+static void list_files(const char *root, buffer *out)
+{
+    static wchar_t dir[PATH_MAX_LEN];
+    static char rel[PATH_MAX_LEN];
+    wchar_t *w = widen(root);
+    size_t n = wcslen(w);
+    if (n + 3 < PATH_MAX_LEN) {
+        wcscpy(dir, w);
+        while (n > 0 && (dir[n - 1] == L'\\' || dir[n - 1] == L'/'))
+            dir[--n] = 0;
+        walk(dir, n, rel, 0, out);
+    }
+    mxFree(w);
+}
+#else
+static void do_rename(const char *from, const char *to)
+{
+    if (rename(from, to) != 0)
+        mexErrMsgIdAndTxt("zarr:StoreError", "rename '%s' -> '%s' failed: %s",
+                          from, to, strerror(errno));
+}
+
+static void do_fsync(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        mexErrMsgIdAndTxt("zarr:StoreError", "fsync: cannot open '%s': %s", path, strerror(errno));
+    int rc;
+    do {
+        rc = fsync(fd);
+    } while (rc != 0 && errno == EINTR);
+    int err = errno;
+    close(fd);
+    /* some filesystems reject fsync on directories; nothing more to do */
+    if (rc != 0 && err != EINVAL && err != EBADF)
+        mexErrMsgIdAndTxt("zarr:StoreError", "fsync '%s' failed: %s", path, strerror(err));
+}
+
+#define CACHE_SIZE 64
+
+typedef struct {
+    char *path;  /* NULL: free slot */
+    int fd;
+    dev_t dev;
+    ino_t ino;
+    unsigned long long used;
+} handle;
+
+static handle cache[CACHE_SIZE];
+static unsigned long long clock_tick;
+
+static void drop(handle *h)
+{
+    close(h->fd);
+    free(h->path);
+    h->path = NULL;
+}
+
+static void forget(const char *path)
+{
+    for (int i = 0; i < CACHE_SIZE; i++)
+        if (cache[i].path && strcmp(cache[i].path, path) == 0)
+            drop(&cache[i]);
+}
+
+static void close_all(void)
+{
+    for (int i = 0; i < CACHE_SIZE; i++)
+        if (cache[i].path)
+            drop(&cache[i]);
+}
+
+/* A read-only descriptor for path and its current size, or -1 when the file
+ * does not exist. */
+static int cached_fd(const char *path, off_t *size)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        if (errno == ENOENT || errno == ENOTDIR) {
+            forget(path);
+            return -1;
+        }
+        mexErrMsgIdAndTxt("zarr:StoreError", "cannot stat '%s': %s", path, strerror(errno));
+    }
+    if (S_ISDIR(st.st_mode))
+        return -1;  /* a directory is not a stored value */
+    *size = st.st_size;
+    handle *slot = NULL;
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (cache[i].path && strcmp(cache[i].path, path) == 0) {
+            if (cache[i].dev == st.st_dev && cache[i].ino == st.st_ino) {
+                cache[i].used = ++clock_tick;
+                return cache[i].fd;
+            }
+            drop(&cache[i]);  /* replaced since it was opened */
+        }
+    }
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (!cache[i].path) {
+            slot = &cache[i];
+            break;
+        }
+        if (!slot || cache[i].used < slot->used)
+            slot = &cache[i];
+    }
+    if (slot->path)
+        drop(slot);
+
+    int fd;
+    do {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return -1;
+        mexErrMsgIdAndTxt("zarr:StoreError", "cannot open '%s': %s", path, strerror(errno));
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        mexErrMsgIdAndTxt("zarr:StoreError", "cannot stat '%s': %s", path, strerror(errno));
+    }
+    *size = st.st_size;
+    size_t n = strlen(path) + 1;
+    slot->path = (char *)malloc(n);
+    if (!slot->path) {
+        close(fd);
+        mexErrMsgIdAndTxt("zarr:StoreError", "out of memory");
+    }
+    memcpy(slot->path, path, n);
+    slot->fd = fd;
+    slot->dev = st.st_dev;
+    slot->ino = st.st_ino;
+    slot->used = ++clock_tick;
+    return fd;
+}
+
+/* Returns NULL when the file does not exist. */
+static mxArray *do_read(const char *path, double offset, double len, int fromEnd)
+{
+    off_t size;
+    int fd = cached_fd(path, &size);
+    if (fd < 0)
+        return NULL;
+    double n = (double)size;
+    if (fromEnd) {
+        offset = len >= 0 && len < n ? n - len : 0;
+        len = n - offset;
+    } else if (len < 0 || offset + len > n) {
+        len = offset < n ? n - offset : 0;
+    }
+    mxArray *out = mxCreateNumericMatrix(1, (mwSize)len, mxUINT8_CLASS, mxREAL);
+    unsigned char *buf = (unsigned char *)mxGetData(out);
+    size_t got = 0, want = (size_t)len;
+    while (got < want) {
+        ssize_t r = pread(fd, buf + got, want - got, (off_t)offset + (off_t)got);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0) {
+            int err = errno;
+            forget(path);
+            mxDestroyArray(out);
+            mexErrMsgIdAndTxt("zarr:StoreError", "read '%s' failed: %s", path, strerror(err));
+        }
+        if (r == 0)
+            break;  /* truncated since the stat */
+        got += (size_t)r;
+    }
+    mxSetN(out, (mwSize)got);
+    return out;
+}
+
+/* dir holds the absolute directory, rel the key prefix of its entries */
+static void walk(char *dir, size_t dlen, char *rel, size_t rlen, int depth, buffer *out)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+        return;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        size_t n = strlen(e->d_name);
+        if (skip_name(e->d_name, n) || dlen + 1 + n >= PATH_MAX_LEN || rlen + n + 1 >= PATH_MAX_LEN)
+            continue;
+        dir[dlen] = '/';
+        memcpy(dir + dlen + 1, e->d_name, n + 1);
+        int isDir = 0;
+#ifdef DT_DIR
+        if (e->d_type == DT_DIR) {
+            isDir = 1;
+        } else if (e->d_type == DT_UNKNOWN || e->d_type == DT_LNK) {
+#else
+        {
+#endif
+            struct stat st;
+            if (stat(dir, &st) != 0) {
+                dir[dlen] = 0;
+                continue;  /* dangling link, or removed while walking */
+            }
+            isDir = S_ISDIR(st.st_mode);
+        }
+        memcpy(rel + rlen, e->d_name, n);
+        if (isDir) {
+            rel[rlen + n] = '/';
+            if (depth < 64)  /* bounds symlink cycles */
+                walk(dir, dlen + 1 + n, rel, rlen + n + 1, depth + 1, out);
+        } else {
+            rel[rlen + n] = '\n';
+            append(out, rel, rlen + n + 1);
+        }
+        dir[dlen] = 0;
+    }
+    closedir(d);
+}
+
+static void list_files(const char *root, buffer *out)
+{
+    static char dir[PATH_MAX_LEN], rel[PATH_MAX_LEN];
+    size_t n = strlen(root);
+    memcpy(dir, root, n + 1);
+    while (n > 1 && dir[n - 1] == '/')
+        dir[--n] = 0;
+    walk(dir, n, rel, 0, 0, out);
+}
+#endif
+
+static double get_count(const mxArray *a, const char *what)
+{
+    if (!mxIsDouble(a) || mxIsComplex(a) || mxGetNumberOfElements(a) != 1)
+        mexErrMsgIdAndTxt("zarr:InternalError", "localfs_mex: %s must be a real double scalar", what);
+    double v = mxGetScalar(a);
+    return mxIsInf(v) ? -1 : v;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    static char cmd[16], a[PATH_MAX_LEN], b[PATH_MAX_LEN];
+    static int registered = 0;
+    (void)nlhs;
+    if (!registered) {
+        mexAtExit(close_all);
+        registered = 1;
+    }
+    if (nrhs < 1 || !mxIsChar(prhs[0]) || mxGetString(prhs[0], cmd, sizeof(cmd)) != 0)
+        mexErrMsgIdAndTxt("zarr:InternalError",
+                          "usage: localfs_mex('rename'|'fsync'|'pread'|'tail'|'list'|'forget'|'closeall', ...)");
+
+    if ((strcmp(cmd, "pread") == 0 && nrhs == 4) || (strcmp(cmd, "tail") == 0 && nrhs == 3)) {
+        int fromEnd = cmd[0] == 't';
+        get_path(prhs[1], a, "path");
+        double offset = fromEnd ? 0 : get_count(prhs[2], "offset");
+        double len = get_count(prhs[nrhs - 1], "len");
+        if (offset < 0)
+            mexErrMsgIdAndTxt("zarr:InternalError", "localfs_mex: offset must be nonnegative");
+        mxArray *data = do_read(a, offset, len, fromEnd);
+        plhs[0] = data ? data : mxCreateNumericMatrix(1, 0, mxUINT8_CLASS, mxREAL);
+        if (nlhs > 1)
+            plhs[1] = mxCreateLogicalScalar(data != NULL);
+    } else if (strcmp(cmd, "list") == 0 && nrhs == 2) {
+        buffer out = {NULL, 0, 0};
+        get_path(prhs[1], a, "dir");
+        list_files(a, &out);
+        plhs[0] = mxCreateNumericMatrix(1, (mwSize)out.len, mxUINT8_CLASS, mxREAL);
+        if (out.len)
+            memcpy(mxGetData(plhs[0]), out.data, out.len);
+        mxFree(out.data);
+    } else if (strcmp(cmd, "forget") == 0 && nrhs == 2) {
+        get_path(prhs[1], a, "path");
+        forget(a);
+    } else if (strcmp(cmd, "closeall") == 0 && nrhs == 1) {
+        close_all();
+    } else if (strcmp(cmd, "rename") == 0 && nrhs == 3) {
+        get_path(prhs[1], a, "from");
+        get_path(prhs[2], b, "to");
+        forget(b);
+        do_rename(a, b);
+    } else if (strcmp(cmd, "fsync") == 0 && nrhs == 2) {
+        get_path(prhs[1], a, "path");
+        do_fsync(a);
+    } else {
+        mexErrMsgIdAndTxt("zarr:InternalError", "localfs_mex: unknown command '%s'", cmd);
+    }
+}
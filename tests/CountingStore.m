@@ -5,6 +5,10 @@ classdef CountingStore < zarr.stores.Store
         nFullGets (1,1) double = 0
         nPartialGets (1,1) double = 0
         nSuffixGets (1,1) double = 0
+        nSets (1,1) double = 0
+        nMetaSets (1,1) double = 0
+        nLists (1,1) double = 0
+        failSetsAfter (1,1) double = Inf   % chunk sets allowed before set errors
     end
 
     properties (Access = private)
@@ -38,6 +42,14 @@ classdef CountingStore < zarr.stores.Store
         end
 
         function set(obj, key, data)
+            if ~endsWith(string(key), "zarr.json")
+                if obj.nSets >= obj.failSetsAfter
+                    error("zarr:StoreError", "Injected failure writing '%s'.", key);
+                end
+                obj.nSets = obj.nSets + 1;
+            else
+                obj.nMetaSets = obj.nMetaSets + 1;
+            end
             obj.inner.set(key, data);
         end
 
@@ -46,6 +58,7 @@ classdef CountingStore < zarr.stores.Store
         end
 
         function ks = list(obj)
+            obj.nLists = obj.nLists + 1;
             ks = obj.inner.list();
         end
 
@@ -57,6 +70,9 @@ classdef CountingStore < zarr.stores.Store
             obj.nFullGets = 0;
             obj.nPartialGets = 0;
             obj.nSuffixGets = 0;
+            obj.nSets = 0;
+            obj.nMetaSets = 0;
+            obj.nLists = 0;
         end
     end
 end
@@ -111,6 +111,21 @@ classdef TestArray < matlab.unittest.TestCase
             tc.verifyFalse(tc.store.exists("c/1/1"));
         end
 
+        function shrinkDeletesGridChunksWithoutListing(tc)
+            probe = CountingStore();
+            z = zarr.create(probe, [6 6 6], "int8", ChunkShape=[2 4 3], Path="g/a");
+            zarr.create(probe, 2, "int8", Path="g/other").write(int8([1; 2]));
+            z.write(ones(6, 6, 6, 'int8'));
+            probe.resetCounts();
+            z.resize([3 4 6]);
+            tc.verifyEqual(probe.nLists, 0, "keys come from the chunk grid");
+            chunks = extractAfter(probe.list(), "g/a/c/");
+            chunks = sort(chunks(~ismissing(chunks)));
+            tc.verifyEqual(chunks, ["0/0/0"; "0/0/1"; "1/0/0"; "1/0/1"]);
+            tc.verifyEqual(zarr.open(probe, Path="g/other").read(), int8([1; 2]));
+            tc.verifyEqual(z.read(), ones(3, 4, 6, 'int8'));
+        end
+
         function appendAlongDims(tc)
             z = zarr.create(tc.store, [2 3], "float64", ChunkShape=[2 2]);
             z(:, :) = ones(2, 3);
@@ -121,6 +136,55 @@ classdef TestArray < matlab.unittest.TestCase
             tc.verifyEqual(z(3, :), 3 * ones(1, 5));
         end
 
+        function streamingAppender(tc)
+            probe = CountingStore();
+            z = zarr.create(probe, [0 3], "float64", ChunkShape=[4 3]);
+            ap = z.openAppender(Dim=1, MetadataInterval=Inf);
+            probe.resetCounts();
+            for i = 1:6
+                ap.append(i * ones(1, 3));
+            end
+            tc.verifyEqual(probe.nSets, 1, "only the completed chunk is stored");
+            tc.verifyEqual(probe.nMetaSets, 0, "shape is committed on flush only");
+            tc.verifyEqual(zarr.open(probe).shape, [0 3]);
+            ap.close();
+            tc.verifyEqual(probe.nMetaSets, 1);
+            tc.verifyEqual(zarr.open(probe).shape, [6 3]);
+
+            % a new session picks up the partial tail chunk
+            ap = zarr.open(probe).openAppender(Dim=1, MetadataInterval=0);
+            ap.append([7 * ones(1, 3); 8 * ones(1, 3)]);
+            tc.verifyEqual(zarr.open(probe).shape, [8 3], "interval 0 commits per chunk");
+            ap.close();
+            tc.verifyEqual(zarr.open(probe).read(), repmat((1:8)', 1, 3));
+            tc.verifyError(@() ap.append(ones(1, 3)), "zarr:StoreError");
+
+            % a failed store ends the session and restores the shape
+            z = zarr.open(probe);
+            ap = z.openAppender(Dim=1, MetadataInterval=Inf);
+            ap.append(9 * ones(3, 3));
+            tc.verifyEqual(z.shape, [11 3]);
+            probe.resetCounts();
+            probe.failSetsAfter = 0;
+            tc.verifyError(@() ap.append(10 * ones(2, 3)), "zarr:StoreError");
+            tc.verifyEqual(z.shape, [8 3], "in-memory shape matches zarr.json");
+            tc.verifyEqual(z.read(), repmat((1:8)', 1, 3));
+            tc.verifyError(@() ap.append(ones(1, 3)), "zarr:StoreError");
+            probe.failSetsAfter = Inf;
+            delete(ap);   % closed: nothing left to flush
+            tc.verifyEqual(zarr.open(probe).shape, [8 3]);
+
+            % a stored chunk is committed by a later append that stores nothing
+            ap = zarr.open(probe).openAppender(Dim=1, MetadataInterval=1);
+            ap.append(ones(4, 3));
+            tc.verifyEqual(zarr.open(probe).shape, [8 3], "within the interval");
+            pause(1.1);
+            ap.append(ones(1, 3));
+            tc.verifyEqual(zarr.open(probe).shape, [12 3]);
+            ap.close();
+            tc.verifyEqual(zarr.open(probe).shape, [13 3]);
+        end
+
         function attributesPersist(tc)
             z = zarr.create(tc.store, 4, "float64", Attributes=struct('a', 1));
             z.setAttr('b', "two");
@@ -129,6 +193,294 @@ classdef TestArray < matlab.unittest.TestCase
             tc.verifyEqual(string(z2.attrs.b), "two");
         end
 
+        function parallelWriteAlignedBlocks(tc)
+            % Without a pool the blocks are written on the client; either
+            % way every block covers its shards, so nothing is read back.
+            probe = CountingStore();
+            z = zarr.create(probe, [10 7], "float64", ChunkShape=[2 2], ShardShape=[4 4]);
+            n = zarr.parallelWrite(z, @(start, count) ...
+                start(1) - 1 + (1:count(1))' + 100 * (start(2) - 1 + (1:count(2))), ...
+                BlockShape=[4 4]);
+            tc.verifyEqual(n, 6);
+            tc.verifyEqual(probe.nFullGets + probe.nPartialGets + probe.nSuffixGets, 0);
+            tc.verifyEqual(z(:, :), (1:10)' + 100 * (1:7));
+            tc.verifyError(@() zarr.parallelWrite(z, @(s, c) 0, BlockShape=[2 2]), ...
+                "zarr:ShapeMismatch");
+        end
+
+        function rechunkWithinMemoryBudget(tc)
+            % column chunks to row chunks: lcm block is the whole array
+            src = zarr.create(zarr.stores.MemoryStore(), [8 12], "float64", ...
+                ChunkShape=[8 2], Attributes=struct("units", "m"));
+            data = reshape(1:96, 8, 12);
+            src(:, :) = data;
+            [dst, plan] = zarr.rechunk(src, zarr.stores.MemoryStore(), ...
+                ChunkShape=[2 12], MaxMemory=1100);
+            tc.verifyEqual(plan.strategy, "direct");
+            tc.verifyEqual(dst.chunkShape, [2 12]);
+            tc.verifyEqual(dst.read(), data);
+            tc.verifyEqual(dst.attrs.units, "m");
+
+            % without Codecs the source chain is kept, resharded as asked
+            gz = zarr.create(zarr.stores.MemoryStore(), [8 12], "float64", ChunkShape=[2 2], ...
+                ShardShape=[8 4], Codecs={zarr.codecs.GzipCodec(3)}, IndexLocation="start");
+            gz(:, :) = data;
+            dst = zarr.rechunk(gz, zarr.stores.MemoryStore(), ChunkShape=[4 4]);
+            tc.verifyEqual(dst.meta.codecs{end}.name, "gzip");
+            tc.verifyEqual(dst.read(), data);
+            dst = zarr.rechunk(gz, zarr.stores.MemoryStore(), ChunkShape=[2 6], ShardShape=[4 12]);
+            tc.verifyEqual(dst.meta.codecs{1}.name, "sharding_indexed");
+            tc.verifyEqual(dst.meta.codecs{1}.chunkShape, [2 6]);
+            tc.verifyEqual(dst.meta.codecs{1}.indexLocation, "start");
+            tc.verifyEqual(dst.meta.codecs{1}.codecs{end}.name, "gzip");
+            tc.verifyEqual(dst.read(), data);
+
+            temp = zarr.stores.MemoryStore();
+            [dst, plan] = zarr.rechunk(src, zarr.stores.MemoryStore(), ...
+                ChunkShape=[2 12], MaxMemory=450, TempStore=temp);
+            tc.verifyEqual(plan.strategy, "two-stage");
+            tc.verifyEqual(plan.intermediateChunkShape, [2 2]);
+            tc.verifyEqual(dst.read(), data);
+            tc.verifyEmpty(temp.list(), "the intermediate array is removed");
+
+            tc.verifyError(@() zarr.rechunk(src, zarr.stores.MemoryStore(), ...
+                ChunkShape=[2 12], MaxMemory=200), "zarr:MemoryBudget");
+
+            % non-nested grids fall back to one target chunk per block
+            src = zarr.create(zarr.stores.MemoryStore(), [6 6], "float64", ChunkShape=[2 2]);
+            src(:, :) = magic(6);
+            [dst, plan] = zarr.rechunk(src, zarr.stores.MemoryStore(), ...
+                ChunkShape=[3 3], MaxMemory=200);
+            tc.verifyEqual(plan.strategy, "blocked");
+            tc.verifyEqual(dst.read(), magic(6));
+        end
+
+        function serialCopiesIgnoreOpenPool(tc)
+            % Without Pool, rechunk and transcoding copies stay on the
+            % client: an open pool must not make them need a parallel-safe
+            % (not in-memory) store.
+            pool = [];
+            try
+                pool = gcp('nocreate');
+                if isempty(pool)
+                    pool = parpool("Threads");
+                    cleaner = onCleanup(@() delete(pool)); %#ok<NASGU>
+                end
+            catch
+            end
+            tc.assumeNotEmpty(pool, "no parallel pool available");
+            src = zarr.create(zarr.stores.MemoryStore(), [8 12], "float64", ChunkShape=[8 2]);
+            d = magic(12);
+            src(:, :) = d(1:8, :);
+            dst = zarr.rechunk(src, zarr.stores.MemoryStore(), ChunkShape=[2 12]);
+            tc.verifyEqual(dst.read(), d(1:8, :));
+            c = zarr.copy(src, zarr.stores.MemoryStore(), Codecs={zarr.codecs.ZlibCodec(1)});
+            tc.verifyEqual(c.read(), d(1:8, :));
+        end
+
+        function transcodeInPlaceResumes(tc)
+            probe = CountingStore();
+            z = zarr.create(probe, [8 8], "float64", ChunkShape=[2 2], ...
+                Codecs={zarr.codecs.GzipCodec(5)});
+            z(:, :) = magic(8);
+            probe.resetCounts();
+            probe.failSetsAfter = 6;   % dies in the second group of 4 chunks
+            tc.verifyError(@() zarr.transcode(z, Codecs={zarr.codecs.ZlibCodec(1)}, ...
+                MaxInFlight=4), "zarr:StoreError");
+            tc.verifyEqual(zarr.open(probe).read(), magic(8), "old array untouched");
+
+            stale = zarr.open(probe);
+            probe.failSetsAfter = Inf;
+            report = zarr.transcode(z, Codecs={zarr.codecs.ZlibCodec(1)}, MaxInFlight=4);
+            tc.verifyEqual(report.resumedAt, 4);
+            tc.verifyEqual(report.chunks, 16);
+            tc.verifyGreaterThan(report.bytesAfter, 0);
+            tc.verifyEqual(z.meta.codecs{end}.name, "numcodecs.zlib", "handle refreshed");
+            tc.verifyEqual(z.read(), magic(8));
+            tc.verifyEqual(zarr.open(probe).read(), magic(8));
+            tc.verifyEqual(z.meta.keySeparator, "/", "key encoding kept");
+            tc.verifyTrue(probe.exists("c/0/0"));
+            tc.verifyFalse(probe.exists("c.0.0"));
+            tc.verifyEmpty(probe.listPrefix(".transcode/"), "staging node removed");
+            tc.verifyFalse(probe.exists(".transcode.json"));
+            % a handle from before the transcode fails instead of reading fill
+            tc.verifyError(@() stale.read(), "zarr:CodecError");
+            stale.refresh();
+            tc.verifyEqual(stale.read(), magic(8));
+
+            % rank 0: the one chunk is staged too, zarr.json goes last
+            probe.failSetsAfter = Inf;
+            s = zarr.create(probe, [], "float64", Path="s", Codecs={zarr.codecs.GzipCodec(5)});
+            s.write(pi);
+            probe.resetCounts();
+            probe.failSetsAfter = 1;   % the chunk is staged, then the run dies
+            tc.verifyError(@() zarr.transcode(s, Codecs={zarr.codecs.ZlibCodec(1)}), ...
+                "zarr:StoreError");
+            tc.verifyEqual(zarr.open(probe, Path="s").read(), pi, "old scalar untouched");
+            probe.failSetsAfter = Inf;
+            report = zarr.transcode(s, Codecs={zarr.codecs.ZlibCodec(1)});
+            tc.verifyEqual(report.chunks, 1);
+            tc.verifyEqual(zarr.open(probe, Path="s").read(), pi);
+
+            % dies in the move: zarr.json already names the new chain and
+            % readers take the chunks not yet moved from the staging node
+            probe = CountingStore();
+            m = zarr.create(probe, [8 8], "float64", ChunkShape=[2 2], ...
+                Codecs={zarr.codecs.GzipCodec(5)});
+            m(:, :) = magic(8);
+            probe.resetCounts();
+            probe.failSetsAfter = 24;   % 16 staged + 5 progress, 3 moved
+            tc.verifyError(@() zarr.transcode(m, Codecs={zarr.codecs.ZlibCodec(1)}, ...
+                MaxInFlight=4, MoveBytes=1), "zarr:StoreError");
+            mid = zarr.open(probe);
+            tc.verifyClass(mid.store, "zarr.internal.StagedChunkStore");
+            tc.verifyEqual(mid.meta.codecs{end}.name, "numcodecs.zlib");
+            tc.verifyEqual(mid.read(), magic(8), "reads through staging mid-move");
+            probe.failSetsAfter = Inf;
+            zarr.transcode(m, Codecs={zarr.codecs.ZlibCodec(1)}, MaxInFlight=4);
+            mid.refresh();
+            tc.verifyFalse(isa(mid.store, "zarr.internal.StagedChunkStore"));
+            tc.verifyEqual(mid.read(), magic(8));
+            tc.verifyFalse(isfield(mid.meta.attributes, "zarr_matlab_transcode"));
+            tc.verifyEmpty(probe.listPrefix(".transcode/"));
+        end
+
+        function multiscalePyramid(tc)
+            g = zarr.create_group(tc.store, Path="img");
+            z = g.createArray("0", [8 6], "float64", ChunkShape=[2 2], ...
+                DimensionNames=["y", "x"]);
+            d = reshape(1:48, 8, 6);
+            z(:, :) = d;
+            [g, levels] = zarr.buildPyramid(z, Levels=2);
+            l1 = (d(1:2:end, 1:2:end) + d(2:2:end, 1:2:end) + ...
+                d(1:2:end, 2:2:end) + d(2:2:end, 2:2:end)) / 4;
+            tc.verifyEqual(levels{2}.read(), l1);
+            % odd edge: the last column pairs with itself
+            l2 = (l1(1:2:end, :) + l1(2:2:end, :)) / 2;
+            tc.verifyEqual(levels{3}.read(), [(l2(:, 1) + l2(:, 2)) / 2, l2(:, 3)]);
+            tc.verifyEqual(levels{3}.shape, [2 2]);
+
+            ms = zarr.open(tc.store, Path="img").attrs.ome.multiscales;
+            tc.verifyEqual(string({ms.datasets.path}), ["0", "1", "2"]);
+            tc.verifyEqual(ms.datasets(3).coordinateTransformations.scale, [4; 4]);
+            tc.verifyEqual(string(ms.axes(2).type), "space");
+
+            [~, levels] = zarr.buildPyramid(z, Levels=1, Method="max", Overwrite=true);
+            tc.verifyEqual(levels{2}.read(), d(2:2:end, 2:2:end));
+        end
+
+        function skipUnchangedChunks(tc)
+            probe = CountingStore();
+            z = zarr.create(probe, [4 4], "float64", ChunkShape=[2 2], ...
+                Codecs={zarr.codecs.GzipCodec(5)});
+            s = zarr.create(probe, [4 4], "float64", Path="s", ChunkShape=[2 2], ...
+                ShardShape=[4 4]);
+            z.skipUnchanged = true;
+            s.skipUnchanged = true;
+            z(:, :) = magic(4);
+            s(:, :) = magic(4);
+            tc.verifyEqual(z.writeStats.chunksStored, 4);
+            probe.resetCounts();
+            z.resetWriteStats();
+            z(:, :) = magic(4);
+            s(:, :) = magic(4);
+            tc.verifyEqual(probe.nSets, 0, "identical re-run stores nothing");
+            tc.verifyEqual(z.writeStats.chunksSkipped, 4);
+            tc.verifyEqual(z.writeStats.requestedBytes, 128);
+            tc.verifyEqual(s.writeStats.chunksSkipped, 1, "the shard is skipped too");
+
+            z(1, 1) = 100;
+            tc.verifyEqual(probe.nSets, 1);
+            tc.verifyEqual(z.writeStats.chunksStored, 1);
+            tc.verifyEqual(z(1, 1), 100);
+        end
+
+        function autoChunkShapes(tc)
+            rec = zarr.recommendChunks([20000 20000], "float64");
+            tc.verifyEqual(rec.chunkShape, [362 362], "~1 MiB, near-cubic");
+            tc.verifyEmpty(rec.shardShape);
+            tc.verifyNotEmpty(rec.reasoning);
+
+            rec = zarr.recommendChunks([1e6 64], "float32", AccessPattern="time-series");
+            tc.verifyEqual(rec.chunkShape, [262144 1]);
+            rec = zarr.recommendChunks([100 2048 2048], "uint16", AccessPattern="image-slices");
+            tc.verifyEqual(rec.chunkShape, [1 724 724]);
+            rec = zarr.recommendChunks([1000 1000], "float64", AccessPattern="random");
+            tc.verifyLessThanOrEqual(rec.chunkBytes, 2^18);
+
+            % too many chunks: grouped into shards
+            rec = zarr.recommendChunks([1e5 1e5], "uint8", MaxChunks=1000);
+            tc.verifyEqual(rec.chunkShape, [1024 1024]);
+            tc.verifyEqual(rec.shardShape, [8192 8192]);
+            tc.verifyEqual(rec.nShards, 169);
+
+            z = zarr.create(tc.store, [4000 4000], "float64", ChunkShape="auto");
+            tc.verifyEqual(z.chunkShape, [362 362]);
+            z = zarr.create(tc.store, [2e5 2e5], "uint8", Path="big", ChunkShape="auto");
+            tc.verifyEqual(z.chunkShape, [8192 8192]);
+            tc.verifyEqual(z.meta.codecs{1}.chunkShape, [1024 1024]);
+        end
+
+        function generatorDrivenWrites(tc)
+            probe = CountingStore();
+            % only the diagonal blocks hold data; the rest come back as fill
+            producer = @(start, count) (start(1) == start(2)) * ones(count);
+            z = zarr.fromFunction(probe, [6 6], "float64", producer, ChunkShape=[2 2]);
+            tc.verifyEqual(probe.nSets, 3, "all-fill blocks are not stored");
+            tc.verifyEqual(z.read(), kron(eye(3), ones(2)));
+
+            % writeFrom on existing data writes every block (erasing fill ones)
+            tc.verifyEqual(z.writeFrom(@(start, count) zeros(count)), 9);
+            tc.verifyEqual(z.read(), zeros(6));
+            tc.verifyFalse(probe.exists("c/0/0"));
+        end
+
+        function metadataBatching(tc)
+            probe = CountingStore();
+            g = zarr.create_group(probe);
+            z = g.createArray("x", [4 4], "float64");
+            probe.resetCounts();
+            function setMany()
+                for i = 1:30
+                    z.setAttr(sprintf('a%d', i), i);
+                end
+            end
+            z.batchMetadata(@setMany);
+            tc.verifyEqual(probe.nMetaSets, 1, "30 attributes, one zarr.json write");
+            tc.verifyEqual(zarr.open(probe, Path="x").attrs.a30, 30);
+
+            % errors roll back, nothing is written
+            probe.resetCounts();
+            function failAfterResize()
+                z.resize([8 4]);
+                z.setAttr('b', 1);
+                error("test:boom", "boom");
+            end
+            tc.verifyError(@() z.batchMetadata(@failAfterResize), "test:boom");
+            tc.verifyEqual(probe.nMetaSets, 0);
+            tc.verifyEqual(z.shape, [4 4]);
+            tc.verifyFalse(isfield(z.attrs, 'b'));
+
+            % shrinking deletes chunks, which a rollback cannot undo
+            z(:, :) = magic(4);
+            z.beginMetadataBatch();
+            tc.verifyError(@() z.resize([2 2]), "zarr:UnsupportedFeature");
+            z.rollbackMetadataBatch();
+            tc.verifyEqual(zarr.open(probe, Path="x").read(), magic(4));
+
+            % begin/commit nest; groups batch the same way
+            g.beginMetadataBatch();
+            g.setAttr('k', 1);
+            g.beginMetadataBatch();
+            g.setAttr('k', 2);
+            g.commitMetadataBatch();
+            tc.verifyEqual(probe.nMetaSets, 0, "inner commit defers to the outer");
+            g.commitMetadataBatch();
+            tc.verifyEqual(probe.nMetaSets, 1);
+            tc.verifyEqual(zarr.open(probe).attrs.k, 2);
+            tc.verifyError(@() g.commitMetadataBatch(), "zarr:StoreError");
+        end
+
         function hierarchy(tc)
             g = zarr.create_group(tc.store);
             sub = g.createGroup("sub");
@@ -236,6 +588,143 @@ classdef TestArray < matlab.unittest.TestCase
             z2 = zarr.open(char(tmp));
             tc.verifyEqual(z2(:, :), d);
         end
+
+        function lockedLocalStoreWrites(tc)
+            tmp = fullfile(tempdir, "zm_lock_" + string(feature('getpid')));
+            cleaner = onCleanup(@() rmdirIf(tmp));
+            ls = zarr.stores.LocalStore(tmp, Locking=true, LockTimeout=5);
+            z = zarr.create(ls, [6 6], "int32", ChunkShape=[4 4]);
+            z(2:5, 2:5) = int32(magic(4));  % partial chunks: locked RMW
+            tc.verifyEqual(z(2:5, 2:5), int32(magic(4)));
+            tc.verifyTrue(isfile(fullfile(tmp, ".zarr-locks", "c", "0", "0.lock")));
+            tc.verifyFalse(any(startsWith(ls.list(), ".zarr-locks")), "lock files are not keys");
+            [dirs, files] = ls.listDir("");
+            tc.verifyEqual(dirs, "c");
+            tc.verifyEqual(files, "zarr.json");
+            % keys ending in .lock are listed like any other
+            ls.set("c/0/0.lock", uint8(1));
+            [~, files] = ls.listDir("c/0");
+            tc.verifyEqual(sort(files), ["0"; "0.lock"; "1"]);
+            tc.verifyTrue(ismember("c/0/0.lock", ls.list()));
+
+            % a released lock can be taken again; a second handle in this
+            % process waits for the first and times out
+            lock = ls.lockKey("c/0/0");
+            other = zarr.stores.LocalStore(tmp, Locking=true, LockTimeout=0.1);
+            tc.verifyError(@() other.lockKey("c/0/0"), "zarr:StoreError");
+            delete(lock);
+            lock = other.lockKey("c/0/0"); %#ok<NASGU>
+            clear lock
+            tc.verifyEmpty(zarr.stores.MemoryStore().lockKey("c/0/0"));
+        end
+
+        function localStoreDurabilityModes(tc)
+            tmp = fullfile(tempdir, "zm_durable_" + string(feature('getpid')));
+            cleaner = onCleanup(@() rmdirIf(tmp));
+            for mode = ["none", "atomic", "durable"]
+                for batched = [false true]
+                    root = fullfile(tmp, mode + "_" + batched);
+                    ls = zarr.stores.LocalStore(root, Durability=mode, BatchSync=batched);
+                    z = zarr.create(ls, [6 6], "float64", ChunkShape=[2 3]);
+                    z(:, :) = magic(6);
+                    z(2:3, 2:3) = 0;
+                    expected = magic(6);
+                    expected(2:3, 2:3) = 0;
+                    tc.verifyEqual(zarr.open(root).read(), expected, mode);
+                    tc.verifyFalse(any(endsWith(ls.list(), ".partial")), mode);
+                end
+            end
+            % an aborted write leaves the old value, even when written in place
+            for mode = ["none", "atomic"]
+                ls = zarr.stores.LocalStore(fullfile(tmp, "abort_" + mode), Durability=mode);
+                ls.set("k", uint8(1:4));
+                w = ls.openWrite("k");
+                w.abort();
+                tc.verifyEqual(ls.get("k"), uint8(1:4), mode);
+                w = ls.openWrite("k");
+                w.commit();
+                tc.verifyEmpty(ls.get("k"), mode);
+            end
+            % every value's data is synced before its rename, batched or not;
+            % batched directory syncs come after the last rename
+            for batched = [false true]
+                ps = ProbeLocalStore(fullfile(tmp, "order_" + batched), ...
+                    Durability="durable", BatchSync=batched);
+                z = zarr.create(ps, [4 4], "float64", ChunkShape=[2 2]);
+                ps.resetCount();
+                z(:, :) = magic(4);
+                ops = ps.fileOps;
+                renames = find(startsWith(ops, "rename "));
+                tc.verifyNumElements(renames, 4);
+                tc.verifyTrue(all(renames > 1));
+                tc.verifyTrue(all(startsWith(ops(renames - 1), "fsync ") & ...
+                    endsWith(ops(renames - 1), ".partial")), join(ops, newline));
+                dirSyncs = find(startsWith(ops, "fsync ") & ~endsWith(ops, ".partial"));
+                tc.verifyNotEmpty(dirSyncs);
+                if batched
+                    tc.verifyGreaterThan(min(dirSyncs), max(renames));
+                end
+            end
+            tc.verifyEmpty(zarr.stores.MemoryStore().batchSync());
+            tc.verifyError(@() zarr.stores.LocalStore(tmp, Durability="fsync"), ...
+                "MATLAB:validators:mustBeMember");
+        end
+
+        function localStoreReadsSeeReplacedValues(tc)
+            % Cached read handles (localfs_mex) must never serve stale bytes.
+            tmp = fullfile(tempdir, "zm_reads_" + string(feature('getpid')));
+            cleaner = onCleanup(@() rmdirIf(tmp));
+            ls = zarr.stores.LocalStore(tmp);
+            ls.set("a/k", uint8(1:10));
+            tc.verifyEqual(ls.getPartial("a/k", 2, 3), uint8(3:5));
+            tc.verifyEqual(ls.getSuffix("a/k", 4), uint8(7:10));
+            tc.verifyEqual(ls.getPartial("a/k", 8, 100), uint8(9:10));
+            ls.set("a/k", uint8(21:25));   % replaced by rename
+            tc.verifyEqual(ls.get("a/k"), uint8(21:25));
+            ls.writeAt("a/k", 0, uint8(99));
+            tc.verifyEqual(ls.getPartial("a/k", 0, 2), uint8([99 22]));
+            other = zarr.stores.LocalStore(tmp);   % a second writer
+            other.set("a/k", uint8(7));
+            tc.verifyEqual(ls.get("a/k"), uint8(7));
+            ls.erase("a/k");
+            [data, found] = ls.get("a/k");
+            tc.verifyFalse(found);
+            tc.verifyEmpty(data);
+            [~, found] = ls.get("a");   % a directory is not a value
+            tc.verifyFalse(found);
+        end
+
+        function asyncWritesKeepOrder(tc)
+            % Runs on the background pool when available, synchronously
+            % otherwise; the results must be identical either way.
+            tmp = fullfile(tempdir, "zm_async_" + string(feature('getpid')));
+            cleaner = onCleanup(@() rmdirIf(tmp));
+            z = zarr.create(char(tmp), [8 8], "float64", ChunkShape=[4 4]);
+            z.asyncMaxBytes = 600;  % forces backpressure between writes
+            expected = zeros(8);
+            for i = 1:6
+                z.writeAsync(i * ones(3, 8), [i 1]);  % overlaps the previous write
+                expected(i:i + 2, :) = i;
+            end
+            z.wait();
+            tc.verifyEqual(zarr.open(char(tmp)).read(), expected);
+
+            % an array cleared without wait() still finishes its writes
+            z.writeAsync(-ones(8));
+            clear z
+            tc.verifyEqual(zarr.open(char(tmp)).read(), -ones(8));
+
+            % in-memory stores are not parallel-safe: writes run inline
+            m = zarr.create(zarr.stores.MemoryStore(), [4 4], "float64", ChunkShape=[2 2]);
+            m.writeAsync(ones(4));
+            tc.verifyEqual(m(:, :), ones(4));
+
+            % the copy of z sent to a worker leaves its pools behind
+            props = ?zarr.Array.PropertyList;
+            for name = ["asyncPool", "codecPool"]
+                tc.verifyTrue(props(string({props.Name}) == name).Transient, name);
+            end
+        end
     end
 end
 
@@ -132,5 +132,26 @@ classdef TestCodecs < matlab.unittest.TestCase
             tc.verifyError(@() zarr.codecs.Pipeline({zarr.codecs.GzipCodec(5), ...
                 zarr.codecs.BytesCodec()}, info, [2 2]), "zarr:InvalidMetadata");
         end
+
+        function tuneCodecsRanksChains(tc)
+            A = repmat(int32(1:64)', 1, 32);   % very compressible
+            [codecs, results] = zarr.tuneCodecs(A, Objective="size", ...
+                ChunkShape=[32 16], Repeats=1);
+            tc.verifyTrue(ismember("gzip-6", results.name));   % no MEX needed
+            tc.verifyTrue(ismember("bytes", results.name));
+            tc.verifyTrue(issorted(results.score, "descend"));
+            tc.verifyGreaterThan(results.ratio(1), 1);
+            tc.verifyEqual(results.ratio(1), max(results.ratio));
+            tc.verifyTrue(any(results.pareto));
+            % the recommendation is a complete chain zarr.create accepts
+            z = zarr.create(zarr.stores.MemoryStore(), [64 32], "int32", ...
+                ChunkShape=[32 16], Codecs=codecs);
+            z(:, :) = A;
+            tc.verifyEqual(z(:, :), A);
+
+            [~, fast] = zarr.tuneCodecs(A, Objective="read", Repeats=1);
+            tc.verifyEqual(fast.decodeMBps(1), max(fast.decodeMBps));
+            tc.verifyError(@() zarr.tuneCodecs(A, ChunkShape=8), "zarr:ShapeMismatch");
+        end
     end
 end
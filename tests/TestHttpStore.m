@@ -6,6 +6,9 @@ classdef TestHttpStore < matlab.unittest.TestCase
         root
         port
         proc
+        rangePort
+        rangeProc
+        rangeReachable = false
         python
     end
 
@@ -57,6 +60,21 @@ classdef TestHttpStore < matlab.unittest.TestCase
                 tc.stopServer();
             end
             tc.assumeTrue(reachable, 'local HTTP server not reachable in this environment');
+
+            % A second server that answers multi-range requests.
+            tc.rangePort = tc.port + 1000;
+            cmd = sprintf('"%s" "%s" %d "%s" >/dev/null 2>&1 & echo $!', tc.python, ...
+                fullfile(projRoot, 'tests', 'range_server.py'), tc.rangePort, tc.root);
+            [~, pidStr] = system(cmd);
+            tc.rangeProc = strtrim(pidStr);
+            for attempt = 1:20
+                if system(sprintf('curl -s -o /dev/null --max-time 1 http://127.0.0.1:%d/zarr.json', ...
+                        tc.rangePort)) == 0
+                    tc.rangeReachable = true;
+                    break
+                end
+                pause(0.25);
+            end
         end
     end
 
@@ -65,6 +83,9 @@ classdef TestHttpStore < matlab.unittest.TestCase
             if ~isempty(tc.proc)
                 system(sprintf('kill %s >/dev/null 2>&1', tc.proc));
             end
+            if ~isempty(tc.rangeProc)
+                system(sprintf('kill %s >/dev/null 2>&1', tc.rangeProc));
+            end
             if ~isempty(tc.root) && isfolder(tc.root)
                 rmdir(tc.root, 's');
             end
@@ -95,6 +116,67 @@ classdef TestHttpStore < matlab.unittest.TestCase
             tc.verifyError(@() zarr.open(store, Path="nope"), "zarr:NodeNotFound");
         end
 
+        function concurrentGetMany(tc)
+            local = zarr.stores.LocalStore(tc.root);
+            keys = ["a/c/0/0"; "a/c/1/1"; "nope"; "a/zarr.json"; "a/c/0/1"; "a/c/1/0"];
+            [want, wantFound] = local.getMany(keys);
+            for limit = [1 2 16]
+                store = zarr.stores.HttpStore(sprintf("http://127.0.0.1:%d", tc.port), ...
+                    MaxConcurrency=limit);
+                [values, found] = store.getMany(keys);
+                tc.verifyEqual(found, wantFound);
+                tc.verifyEqual(values(found), want(wantFound));
+                % whole-array read: all four chunks fetched in one batch
+                tc.verifyEqual(zarr.open(store, Path="a").read(), reshape(1:80, [10 8]));
+            end
+            tc.verifyEqual(store.getPartial("a/zarr.json", 2, 5), want{4}(3:7));
+            tc.verifyEqual(store.getSuffix("a/zarr.json", 3), want{4}(end-2:end));
+        end
+
+        function multiRangeShardReads(tc)
+            tc.assumeTrue(tc.rangeReachable, 'multi-range test server not reachable');
+            local = zarr.stores.LocalStore(tc.root);
+            offs = [0 40 200 41];
+            lens = [8 16 4 2];
+            [want, found] = local.getRanges("s/c/0/0", offs, lens);
+            tc.verifyTrue(found);
+            d = reshape(int32(1:64), [8 8]);
+            % http.server ignores Range; range_server.py answers with
+            % multipart/byteranges. MaxRangeGap=0 keeps the ranges apart.
+            for p = [tc.port, tc.rangePort]
+                store = zarr.stores.HttpStore(sprintf("http://127.0.0.1:%d", p), MaxRangeGap=0);
+                [parts, found] = store.getRanges("s/c/0/0", offs, lens);
+                tc.verifyTrue(found);
+                tc.verifyEqual(parts, want);
+                [~, found] = store.getRanges("nope", offs, lens);
+                tc.verifyFalse(found);
+                if p == tc.rangePort
+                    % a server error raises; it is not taken for a refusal
+                    tc.verifyError(@() store.getRanges("_fail", offs, lens), "zarr:StoreError");
+                    before = multipartReplies(store);
+                end
+                % a column of inner chunks: not contiguous in the shard
+                s = zarr.open(store, Path="s");
+                tc.verifyEqual(s(1:8, 1:2), d(:, 1:2));
+                tc.verifyEqual(s(:, :), d);
+            end
+            tc.verifyGreaterThan(multipartReplies(store), before, ...
+                "shard reads used multi-range requests");
+
+            % a server that answers one range of several (like S3) is asked
+            % once: not for the later batches of 64, nor on later calls
+            offs = 0:2:300;   % 151 spans, three batches
+            lens = ones(size(offs));
+            want = local.getRanges("s/c/0/0", offs, lens);
+            single = zarr.stores.HttpStore(sprintf("http://127.0.0.1:%d/_single", tc.rangePort), ...
+                MaxRangeGap=0);
+            before = multiRangeRequests(store);
+            tc.verifyEqual(single.getRanges("s/c/0/0", offs, lens), want);
+            tc.verifyEqual(multiRangeRequests(store) - before, 1);
+            tc.verifyEqual(single.getRanges("s/c/0/0", offs, lens), want);
+            tc.verifyEqual(multiRangeRequests(store) - before, 1);
+        end
+
         function readOnlyEnforced(tc)
             store = zarr.stores.HttpStore(sprintf("http://127.0.0.1:%d", tc.port));
             tc.verifyError(@() store.set("x", uint8(1)), "zarr:StoreError");
@@ -102,3 +184,13 @@ classdef TestHttpStore < matlab.unittest.TestCase
         end
     end
 end
+
+function n = multipartReplies(store)
+% Multipart replies range_server.py has sent so far.
+n = str2double(native2unicode(store.get("_multipart"), 'UTF-8'));
+end
+
+function n = multiRangeRequests(store)
+% Multi-range requests range_server.py has received so far.
+n = str2double(native2unicode(store.get("_multirange"), 'UTF-8'));
+end
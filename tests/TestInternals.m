@@ -65,6 +65,15 @@ classdef TestInternals < matlab.unittest.TestCase
             end
         end
 
+        function alignedBlocksTileTheArray(tc)
+            [starts, counts] = zarr.internal.aligned_blocks([5 7], [2 4]);
+            tc.verifyEqual(starts, [1 1; 1 5; 3 1; 3 5; 5 1; 5 5]);
+            tc.verifyEqual(counts, [2 4; 2 3; 2 4; 2 3; 1 4; 1 3]);
+            tc.verifyEqual(sum(prod(counts, 2)), 35);
+            [starts, ~] = zarr.internal.aligned_blocks([0 3], [2 2]);
+            tc.verifySize(starts, [0 2]);
+        end
+
         function mshapeMapping(tc)
             tc.verifyEqual(zarr.internal.mshape([]), [1 1]);
             tc.verifyEqual(zarr.internal.mshape(5), [5 1]);
@@ -41,6 +41,25 @@ classdef TestZipAndConsolidated < matlab.unittest.TestCase
             rs.close();
         end
 
+        function zipStreamedShardsSpillToDisk(tc)
+            p = fullfile(tc.work, "s.zarr.zip");
+            ws = zarr.stores.ZipStore(p, Mode="w");
+            z = zarr.create(ws, [8 8], "float64", ChunkShape=[2 2], ShardShape=[4 8]);
+            d = magic(8);
+            z(:, :) = d;
+            tc.verifyEqual(z(:, :), d, 'spilled shards readable before close');
+            z(1:4, :) = d(1:4, :) + 1;  % replaces a spilled value
+            n = ws.sizeOf("c/0/0");
+            tc.verifyEqual(n, numel(ws.get("c/0/0")), 'size of a spilled value');
+            ws.close();
+            rs = zarr.stores.ZipStore(p);
+            tc.verifyEqual(zarr.open(rs).read(), [d(1:4, :) + 1; d(5:8, :)]);
+            tc.verifyEqual(rs.sizeOf("c/0/0"), n, 'size from the central directory');
+            [~, found] = rs.sizeOf("c/9/9");
+            tc.verifyFalse(found);
+            rs.close();
+        end
+
         function zipReadOnlyEnforced(tc)
             p = fullfile(tc.work, "b.zarr.zip");
             ws = zarr.stores.ZipStore(p, Mode="w");
@@ -111,6 +130,30 @@ classdef TestZipAndConsolidated < matlab.unittest.TestCase
             tc.verifyEqual(string(g.attrs.t), "root");
         end
 
+        function listPrefixAndNodeWalk(tc)
+            root = fullfile(tc.work, "lp.zarr");
+            ls = zarr.stores.LocalStore(root);
+            zarr.create_group(ls);
+            zarr.create(ls, [4 4], "float64", Path="g/x", ChunkShape=[2 2]).write(magic(4));
+            zarr.create(ls, [4 4], "float64", Path="g/xy", ChunkShape=[2 2], ...
+                ChunkKeyEncoding="v2").write(magic(4));
+            everything = ls.list();
+            tc.verifyEqual(numel(everything), 1 + 1 + 5 + 5);
+            tc.verifyTrue(issorted(everything));
+            tc.verifyEqual(ls.listPrefix("g/x/"), everything(startsWith(everything, "g/x/")));
+            tc.verifyEqual(ls.listPrefix("g/x"), everything(startsWith(everything, "g/x")));
+            tc.verifyEqual(ls.listPrefix("g/x/c/"), "g/x/c/" + ["0/0"; "0/1"; "1/0"; "1/1"]);
+            tc.verifyEmpty(ls.listPrefix("missing/"));
+            % the base implementation filters list()
+            mem = zarr.stores.MemoryStore();
+            zarr.copy(zarr.open(ls), mem);
+            tc.verifyEqual(mem.listPrefix("g/x"), everything(startsWith(everything, "g/x")));
+
+            zarr.consolidate_metadata(ls);
+            g = zarr.open(root);
+            tc.verifyEqual(sort(string(g.meta.consolidated.keys()))', ["g"; "g/x"; "g/xy"]);
+        end
+
         function consolidatedAvoidsStoreReads(tc)
             root = fullfile(tc.work, "d.zarr");
             ls = zarr.stores.LocalStore(root);
@@ -138,5 +181,40 @@ classdef TestZipAndConsolidated < matlab.unittest.TestCase
             tc.verifyEqual(g2.attrs.new, 42);
             tc.verifyNotEmpty(g2.meta.consolidated, 'consolidation survives setAttr');
         end
+
+        function copyMirrorsRawBytesOrTranscodes(tc)
+            root = fullfile(tc.work, "f.zarr");
+            ls = zarr.stores.LocalStore(root);
+            zarr.create_group(ls, Attributes=struct('t', "root"));
+            d = magic(8);
+            d = d(1:6, :);
+            zarr.create(ls, [6 8], "float64", Path="x", ChunkShape=[3 4], ...
+                Codecs={zarr.codecs.GzipCodec(5)}).write(d);
+            zarr.create(ls, [8 8], "int16", Path="sub/y", ChunkShape=[2 2], ...
+                ShardShape=[4 4]).write(int16(magic(8)));
+            zarr.consolidate_metadata(ls);
+
+            % raw mirror into a zip: identical bytes under every key
+            p = fullfile(tc.work, "f.zarr.zip");
+            ws = zarr.stores.ZipStore(p, Mode="w");
+            g = zarr.copy(zarr.open(ls), ws, BatchSize=2);
+            tc.verifyEqual(sort(ws.list()), sort(ls.list()));
+            tc.verifyEqual(ws.get("sub/y/c/0/0"), ls.get("sub/y/c/0/0"));
+            tc.verifyNotEmpty(g.meta.consolidated);
+            ws.close();
+
+            % a subtree under a new path, and a transcoded copy
+            mem = zarr.stores.MemoryStore();
+            y = zarr.copy(zarr.open(ls, Path="sub/y"), mem, Path="mirror/y");
+            tc.verifyEqual(y.read(), int16(magic(8)));
+            tc.verifyError(@() zarr.copy(zarr.open(ls, Path="sub/y"), mem, Path="mirror/y"), ...
+                "zarr:NodeExists");
+            t = zarr.copy(zarr.open(ls), mem, Path="", Overwrite=true, ...
+                Codecs={zarr.codecs.ZlibCodec(1)});
+            tc.verifyEqual(t.item("x").read(), d);
+            tc.verifyEqual(t.item("x").meta.codecs{end}.name, "numcodecs.zlib");
+            tc.verifyEqual(t.item("sub").item("y").read(), int16(magic(8)));
+            tc.verifyEqual(string(t.attrs.t), "root");
+        end
     end
 end
@@ -0,0 +1,80 @@
+"""Static file server with multi-range support, for TestHttpStore.
+
+    python range_server.py PORT ROOT
+
+http.server ignores Range; nginx and most object stores answer multiple
+ranges with multipart/byteranges, which this mimics. Under /_single/ the
+same files are served like S3 does, answering only the first of several
+ranges. GET /_fail answers 500, for error handling tests, GET /_multipart
+the number of multipart replies sent so far, and GET /_multirange the
+number of multi-range requests received.
+"""
+import http.server
+import os
+import re
+import sys
+
+class RangeHandler(http.server.SimpleHTTPRequestHandler):
+    """Static files with single and multiple byte-range support."""
+    protocol_version = "HTTP/1.1"
+    multipart_replies = 0
+    multirange_requests = 0
+
+    def do_GET(self):
+        if self.path == "/_fail":
+            self.send_error(500)
+            return
+        if self.path == "/_multipart":
+            self.reply(200, str(RangeHandler.multipart_replies).encode(), "text/plain")
+            return
+        if self.path == "/_multirange":
+            self.reply(200, str(RangeHandler.multirange_requests).encode(), "text/plain")
+            return
+        single = self.path.startswith("/_single/")
+        path = self.translate_path(self.path[len("/_single"):] if single else self.path)
+        if not os.path.isfile(path):
+            self.send_error(404)
+            return
+        with open(path, "rb") as f:
+            data = f.read()
+        spec = self.headers.get("Range", "")
+        m = re.fullmatch(r"bytes=([\d\-,]+)", spec)
+        if not m:
+            self.reply(200, data, "application/octet-stream")
+            return
+        ranges = []
+        for r in m.group(1).split(","):
+            a, b = r.split("-")
+            if a == "":
+                a, b = max(0, len(data) - int(b)), len(data) - 1
+            a, b = int(a), min(int(b) if b else len(data) - 1, len(data) - 1)
+            ranges.append((a, b))
+        if len(ranges) > 1:
+            RangeHandler.multirange_requests += 1
+        if len(ranges) == 1 or single:
+            a, b = ranges[0]
+            self.reply(206, data[a:b + 1], "application/octet-stream",
+                       {"Content-Range": f"bytes {a}-{b}/{len(data)}"})
+            return
+        body = b""
+        for a, b in ranges:
+            body += (f"\r\n--SEP\r\nContent-Type: application/octet-stream\r\n"
+                     f"Content-Range: bytes {a}-{b}/{len(data)}\r\n\r\n").encode() + data[a:b + 1]
+        body += b"\r\n--SEP--\r\n"
+        RangeHandler.multipart_replies += 1
+        self.reply(206, body, "multipart/byteranges; boundary=SEP")
+
+    def reply(self, status, body, ctype, headers=None):
+        self.send_response(status)
+        self.send_header("Content-Type", ctype)
+        self.send_header("Content-Length", str(len(body)))
+        for k, v in (headers or {}).items():
+            self.send_header(k, v)
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, *args):
+        pass
+
+os.chdir(sys.argv[2])
+http.server.ThreadingHTTPServer(("127.0.0.1", int(sys.argv[1])), RangeHandler).serve_forever()
@@ -1,13 +1,15 @@
 classdef ProbeLocalStore < zarr.stores.LocalStore
-    %PROBELOCALSTORE LocalStore that counts get() calls after resetCount().
+    %PROBELOCALSTORE LocalStore that counts get() calls after resetCount()
+    %   and logs its renames and fsyncs ("rename <to>", "fsync <path>").
 
     properties
         nGets (1,1) double = 0
+        fileOps = strings(0, 1)
     end
 
     methods
-        function obj = ProbeLocalStore(root)
-            obj@zarr.stores.LocalStore(root);
+        function obj = ProbeLocalStore(root, varargin)
+            obj@zarr.stores.LocalStore(root, varargin{:});
         end
 
         function [data, found] = get(obj, key)
@@ -17,6 +19,14 @@ classdef ProbeLocalStore < zarr.stores.LocalStore
 
         function resetCount(obj)
             obj.nGets = 0;
+            obj.fileOps = strings(0, 1);
+        end
+    end
+
+    methods (Access = protected)
+        function fileOp(obj, cmd, varargin)
+            obj.fileOps(end + 1, 1) = cmd + " " + string(varargin{end});
+            fileOp@zarr.stores.LocalStore(obj, cmd, varargin{:});
         end
     end
 end
@@ -1,5 +1,6 @@
 function build_mex()
-%BUILD_MEX Build the zstd and blosc MEX codecs into +zarr/+internal.
+%BUILD_MEX Build the zstd and blosc MEX codecs (and the self-contained
+%   crc32c and localfs helpers) into +zarr/+internal.
 %   Links against Homebrew (macOS) or system libzstd / libblosc. Static
 %   libraries are preferred when present so the binaries are relocatable.
 
@@ -22,6 +23,8 @@ buildOne(fullfile(srcDir, 'zstd_mex.c'), outDir, zstdPrefix, "zstd");
 buildOne(fullfile(srcDir, 'blosc_mex.c'), outDir, bloscPrefix, "blosc");
 mex('-silent', fullfile(srcDir, 'crc32c_mex.c'), '-outdir', char(outDir), ...
     '-output', 'crc32c_mex');
+mex('-silent', fullfile(srcDir, 'localfs_mex.c'), '-outdir', char(outDir), ...
+    '-output', 'localfs_mex');
 fprintf('MEX codecs built into %s\n', outDir);
 end
 
@@ -9,5 +9,18 @@ assert(isequal(zarr.internal.blosc_mex('decompress', b), a), 'blosc round trip')
 b2 = zarr.internal.blosc_mex('compress', a, 'lz4', 5, 1, 1);
 assert(isequal(zarr.internal.blosc_mex('decompress', b2), a), 'blosc lz4 round trip');
 assert(zarr.internal.crc32c_mex(uint8('123456789')) == uint32(hex2dec('E3069283')), 'crc32c KAT');
+d = tempname;
+mkdir(d);
+cleaner = onCleanup(@() rmdir(d, 's'));
+src = fullfile(d, 'a.partial');
+dst = fullfile(d, 'a');
+fid = fopen(src, 'w'); fwrite(fid, a); fclose(fid);
+zarr.internal.localfs_mex('fsync', src);
+zarr.internal.localfs_mex('rename', src, dst);
+zarr.internal.localfs_mex('fsync', d);
+assert(~isfile(src) && isfile(dst), 'localfs rename');
+assert(isequal(zarr.internal.localfs_mex('pread', dst, 4, 8), a(5:12)), 'localfs pread');
+assert(isequal(zarr.internal.localfs_mex('tail', dst, 3), a(end-2:end)), 'localfs tail');
+zarr.internal.localfs_mex('closeall');
 disp('mex smoke ok');
 end